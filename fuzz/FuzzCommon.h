@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../src/lexer.h"
+
+// Shared pieces of the fuzz targets: a per-input time budget and the checks
+// that two token streams are identical.
+
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define FUZZ_SANITIZED 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer) || __has_feature(memory_sanitizer)
+#define FUZZ_SANITIZED 1
+#endif
+#endif
+
+// Stops the run when one input takes longer than a budget that grows linearly
+// with its size, so quadratic (or worse) paths in the lexer and parser show up
+// as crashes instead of as slow executions. Each target passes what its timed
+// section costs per byte in an -O2 build without sanitizers; the budget allows
+// kMargin times that, scaled for sanitizer and unoptimized builds.
+// FUZZ_MAX_NS_PER_BYTE replaces the resulting per-byte allowance.
+// Time is process CPU time (all threads), so waiting to be scheduled, which
+// dominates small inputs on a loaded machine, is not charged to the input.
+class Watchdog {
+public:
+    Watchdog(size_t size, uint64_t nsPerByte)
+        : size(size), perByte(allowance(nsPerByte)), start(std::clock()) {}
+
+    ~Watchdog() {
+        uint64_t ns = (uint64_t)((double)(std::clock() - start) * (1e9 / CLOCKS_PER_SEC));
+        uint64_t budget = kFixedNs * kBuildSlowdown + perByte * (uint64_t)size;
+        if (ns > budget) {
+            std::fprintf(stderr, "watchdog: %zu-byte input took %llu ns (budget %llu ns)\n",
+                         size, (unsigned long long)ns, (unsigned long long)budget);
+            std::abort();
+        }
+    }
+
+private:
+    static constexpr uint64_t kFixedNs = 1'000'000;   // thread start-up for the parallel paths
+    static constexpr uint64_t kMargin = 3;
+    static constexpr uint64_t kBuildSlowdown = 1
+#ifdef FUZZ_SANITIZED
+        * 10   // ASan/UBSan measured at 5-7x, plus libFuzzer's coverage instrumentation
+#endif
+#ifndef __OPTIMIZE__
+        * 5    // -O0 measured at 3-4x
+#endif
+        ;
+
+    static uint64_t allowance(uint64_t nsPerByte) {
+        static const char* env = std::getenv("FUZZ_MAX_NS_PER_BYTE");
+        return env ? std::strtoull(env, nullptr, 10) : nsPerByte * kMargin * kBuildSlowdown;
+    }
+
+    size_t size;
+    uint64_t perByte;
+    std::clock_t start;
+};
+
+[[noreturn]] inline void fuzzMismatch(const char* what, size_t index) {
+    std::fprintf(stderr, "differential mismatch: %s (token %zu)\n", what, index);
+    std::abort();
+}
+
+inline void expectSameTokens(const std::vector<Token>& a, const std::vector<Token>& b, const char* what) {
+    if (a.size() != b.size()) fuzzMismatch(what, a.size() < b.size() ? a.size() : b.size());
+    for (size_t i = 0; i < a.size(); ++i)
+        if (a[i].type != b[i].type || a[i].value != b[i].value || a[i].offset != b[i].offset)
+            fuzzMismatch(what, i);
+}
+
+inline void expectSameTokens(const std::vector<Token>& a, const TokenBuffer& b, const char* what) {
+    if (a.size() != b.size()) fuzzMismatch(what, a.size() < b.size() ? a.size() : b.size());
+    for (size_t i = 0; i < a.size(); ++i)
+        if (a[i].type != b.type(i) || a[i].value != b.text(b.tokens[i]) || a[i].offset != b.location(b.tokens[i]))
+            fuzzMismatch(what, i);
+}
+
+// Packed buffers must also agree on converted literal values, not just text.
+inline void expectSameTokens(const TokenBuffer& a, const TokenBuffer& b, const char* what) {
+    if (a.size() != b.size()) fuzzMismatch(what, a.size() < b.size() ? a.size() : b.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+        const PackedToken& x = a.tokens[i];
+        const PackedToken& y = b.tokens[i];
+        if (x.type() != y.type() || a.text(x) != b.text(y) || a.location(x) != b.location(y))
+            fuzzMismatch(what, i);
+        bool badX = x.payload == PackedToken::kBadLiteral, badY = y.payload == PackedToken::kBadLiteral;
+        if (x.type() == TokenType::INTLIT &&
+            (badX != badY || (!badX && a.ints[a.literal(x)] != b.ints[b.literal(y)])))
+            fuzzMismatch(what, i);
+        if (x.type() == TokenType::FLOATLIT &&
+            (badX != badY || (!badX && std::memcmp(&a.floats[a.literal(x)], &b.floats[b.literal(y)], sizeof(double)) != 0)))
+            fuzzMismatch(what, i);
+    }
+}
@@ -0,0 +1,42 @@
+// Replays files through LLVMFuzzerTestOneInput() for toolchains without
+// libFuzzer; arguments may be files or directories (read one level deep).
+//
+//   g++ -std=c++17 -g -O1 -pthread -fsanitize=address,undefined
+//       fuzz/StandaloneMain.cpp fuzz/parser_fuzzer.cpp src/lexer.cpp src/Parser.cpp src/AST.cpp
+//       src/SourceMap.cpp src/ExprInterner.cpp -o parser_replay
+//   ./parser_replay fuzz/corpus
+//
+// engine_fuzzer.cpp also needs src/Interpreter.cpp. g++'s -fsanitize=undefined
+// leaves out float-cast-overflow (clang's includes it); add it for that target.
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+static void runFile(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size());
+}
+
+int main(int argc, char** argv) {
+    size_t count = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::filesystem::path arg(argv[i]);
+        if (std::filesystem::is_directory(arg)) {
+            for (const auto& entry : std::filesystem::directory_iterator(arg))
+                if (entry.is_regular_file()) { runFile(entry.path()); ++count; }
+        } else {
+            runFile(arg);
+            ++count;
+        }
+    }
+    std::cerr << "ran " << count << " inputs\n";
+    return 0;
+}
@@ -0,0 +1,83 @@
+// libFuzzer target for the execution engine. Every input that parses is run
+// twice: with tiering off (tier 0 only) and with hotCallThreshold 0 (every
+// function compiled to tier 1 on its first call). Both runs must return the
+// same value or fail with the same RuntimeError at the same source offset.
+//
+// Tier 1 inlines small callees, and inlined calls do not count toward the call
+// depth or the call limit, so runs stopped by either limit are not compared;
+// they still have to end without crashing. The limits are lowered so that
+// exponential call trees and string doubling finish quickly.
+//
+//   clang++ -std=c++17 -g -O1 -fsanitize=fuzzer,address,undefined
+//       fuzz/engine_fuzzer.cpp src/Interpreter.cpp src/lexer.cpp src/Parser.cpp src/AST.cpp
+//       src/SourceMap.cpp src/ExprInterner.cpp -o engine_fuzzer
+//   ./engine_fuzzer -dict=fuzz/lang.dict fuzz/corpus
+//
+// Without clang, build with fuzz/StandaloneMain.cpp instead of -fsanitize=fuzzer
+// (see that file) to replay the corpus under g++ sanitizers.
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include "FuzzCommon.h"
+#include "../src/Interpreter.h"
+#include "../src/Parser.h"
+
+namespace {
+constexpr uint64_t kMaxCalls = 20000;
+constexpr size_t kMaxCallDepth = 200;
+constexpr size_t kMaxStringLength = 1 << 16;
+constexpr uint64_t kNsPerByte = 70;     // lexing and parsing only, -O2 (see Watchdog)
+
+// "<type>:<value>" (floats by bit pattern), or "error: <message> @<offset>".
+std::string outcome(const std::shared_ptr<Program>& program, uint64_t hotCallThreshold) {
+    EngineOptions opts;
+    opts.hotCallThreshold = hotCallThreshold;
+    opts.maxCalls = kMaxCalls;
+    opts.maxCallDepth = kMaxCallDepth;
+    opts.maxStringLength = kMaxStringLength;
+    try {
+        Value v = ExecutionEngine(program, opts).run();
+        if (auto* d = std::get_if<double>(&v)) {
+            uint64_t bits;
+            std::memcpy(&bits, d, sizeof bits);
+            return "float:" + std::to_string(bits);
+        }
+        return (v.index() == 0 ? "int:" : "string:") + valueToString(v);
+    } catch (const RuntimeError& e) {
+        return std::string("error: ") + e.what() + " @" + (e.offset ? std::to_string(*e.offset) : "-");
+    }
+}
+
+bool hitLimit(const std::string& result) {
+    return result.rfind("error: Call depth exceeded", 0) == 0 || result.rfind("error: Call limit exceeded", 0) == 0;
+}
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    std::string input(reinterpret_cast<const char*>(data), size);
+    std::shared_ptr<Program> program;
+    {
+        Watchdog watchdog(size, kNsPerByte);
+        std::ostringstream diagnostics;
+        Lexer lexer(input);
+        lexer.setDiagnostics(diagnostics);
+        TokenBuffer tokens;
+        lexer.tokenize(tokens);
+        try {
+            program = Parser(tokens).parseProgram();
+        } catch (const ParseException&) {
+            return 0;
+        }
+    }
+
+    std::string tier0 = outcome(program, UINT64_MAX);
+    std::string tier1 = outcome(program, 0);
+    if (tier0 != tier1 && !hitLimit(tier0) && !hitLimit(tier1)) {
+        std::fprintf(stderr, "tier 0: %s\ntier 1: %s\n", tier0.c_str(), tier1.c_str());
+        fuzzMismatch("hotCallThreshold 0", 0);
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+// libFuzzer target for the lexer. Every input is lexed four ways - tokenize(),
+// the packed tokenize(TokenBuffer&), and both tokenizeParallel() forms with tiny
+// chunks so that chunk boundaries land inside the input - and the results must
+// agree, diagnostics (with their file:line:col prefixes) and converted literal
+// values included. A token-length limit is set so that some inputs make every
+// path throw; they must all throw the same error after the same diagnostics.
+//
+//   clang++ -std=c++17 -g -O1 -fsanitize=fuzzer,address,undefined
+//       fuzz/lexer_fuzzer.cpp src/lexer.cpp src/SourceMap.cpp -o lexer_fuzzer
+//   ./lexer_fuzzer -dict=fuzz/lang.dict fuzz/corpus
+//
+// Without clang, build with fuzz/StandaloneMain.cpp instead of -fsanitize=fuzzer
+// (see that file) to replay the corpus under g++ sanitizers.
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "FuzzCommon.h"
+#include "../src/SourceMap.h"
+
+namespace {
+constexpr unsigned kThreads = 4;
+constexpr size_t kChunkBytes = 16;
+constexpr size_t kMaxTokenLength = 64;   // spans several chunks
+// All four lexes at -O2 (see Watchdog). Valid code costs ~150; input that is
+// all invalid bytes, one positioned diagnostic each, is the worst case.
+constexpr uint64_t kNsPerByte = 450;
+
+// The error message of one lex, or "" if it succeeded.
+template <typename Lex>
+std::string lexError(Lex lex) {
+    try {
+        lex();
+        return "";
+    } catch (const std::length_error& e) {
+        return e.what();
+    }
+}
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    Watchdog watchdog(size, kNsPerByte);
+    std::string input(reinterpret_cast<const char*>(data), size);
+
+    std::ostringstream diagSerial, diagPacked, diagParallel, diagPackedParallel;
+    SourceMap locations("input", input);
+    Lexer lexer(input);
+    lexer.setSourceMap(&locations);
+    lexer.setMaxTokenLength(kMaxTokenLength);
+    lexer.setDiagnostics(diagSerial);
+    std::vector<Token> serial;
+    std::string error = lexError([&] { serial = lexer.tokenize(); });
+
+    TokenBuffer packed;
+    lexer.reset(input);
+    lexer.setDiagnostics(diagPacked);
+    if (lexError([&] { lexer.tokenize(packed); }) != error) fuzzMismatch("packed error", 0);
+    if (error.empty()) expectSameTokens(serial, packed, "tokenize(TokenBuffer&)");
+    if (diagSerial.str() != diagPacked.str()) fuzzMismatch("packed diagnostics", 0);
+
+    std::vector<Token> parallel;
+    lexer.reset(input);
+    lexer.setDiagnostics(diagParallel);
+    if (lexError([&] { parallel = lexer.tokenizeParallel(kThreads, kChunkBytes); }) != error)
+        fuzzMismatch("parallel error", 0);
+    if (error.empty()) expectSameTokens(serial, parallel, "tokenizeParallel()");
+    if (diagSerial.str() != diagParallel.str()) fuzzMismatch("parallel diagnostics", 0);
+
+    TokenBuffer packedParallel;
+    lexer.reset(input);
+    lexer.setDiagnostics(diagPackedParallel);
+    if (lexError([&] { lexer.tokenizeParallel(packedParallel, kThreads, kChunkBytes); }) != error)
+        fuzzMismatch("packed parallel error", 0);
+    if (error.empty()) expectSameTokens(packed, packedParallel, "tokenizeParallel(TokenBuffer&)");
+    if (diagSerial.str() != diagPackedParallel.str()) fuzzMismatch("packed parallel diagnostics", 0);
+    return 0;
+}
@@ -0,0 +1,105 @@
+// libFuzzer target for the parser. The input is lexed once and parsed three
+// ways - from a std::vector<Token>, from the packed TokenBuffer, and with
+// parseProgramParallel() on tiny segments - and all three must print the same
+// AST, source locations included, or throw the same ParseException. A fourth,
+// hash-consed parallel parse must print the same tree (shared nodes report the
+// location of their first occurrence, so positions are not compared there).
+//
+//   clang++ -std=c++17 -g -O1 -fsanitize=fuzzer,address,undefined
+//       fuzz/parser_fuzzer.cpp src/lexer.cpp src/Parser.cpp src/AST.cpp src/SourceMap.cpp
+//       src/ExprInterner.cpp -o parser_fuzzer
+//   ./parser_fuzzer -dict=fuzz/lang.dict fuzz/corpus
+//
+// Without clang, build with fuzz/StandaloneMain.cpp instead of -fsanitize=fuzzer
+// (see that file) to replay the corpus under g++ sanitizers.
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include "FuzzCommon.h"
+#include "../src/Parser.h"
+#include "../src/SourceMap.h"
+
+namespace {
+constexpr unsigned kThreads = 4;
+constexpr size_t kChunkTokens = 8;
+constexpr uint64_t kNsPerByte = 500;    // two lexes and four parses, -O2 (see Watchdog)
+
+// FNV-1a of everything written to it. printAST() indents by depth, so its
+// output grows with depth * nodes; hashing keeps comparisons in constant memory.
+class HashBuf : public std::streambuf {
+public:
+    uint64_t hash = 1469598103934665603ull;
+protected:
+    int_type overflow(int_type c) override {
+        if (c != traits_type::eof()) mix((unsigned char)c);
+        return traits_type::not_eof(c);
+    }
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        for (std::streamsize i = 0; i < n; ++i) mix((unsigned char)s[i]);
+        return n;
+    }
+private:
+    void mix(unsigned char c) { hash = (hash ^ c) * 1099511628211ull; }
+};
+
+struct Outcome {
+    std::shared_ptr<Program> program;
+    std::string error;                  // "<kind>: <message> @<offset>" when parsing failed
+};
+
+template <typename Parse>
+Outcome attempt(Parse parse) {
+    Outcome out;
+    try {
+        out.program = parse();
+    } catch (const ParseException& e) {
+        out.error = std::to_string((int)e.kind) + ": " + e.what() + " @" + (e.offset ? std::to_string(*e.offset) : "-");
+    }
+    return out;
+}
+
+bool same(const Outcome& a, const Outcome& b, const SourceMap* locations) {
+    if (!a.program || !b.program) return !a.program && !b.program && a.error == b.error;
+    HashBuf ha, hb;
+    std::streambuf* saved = std::cout.rdbuf(&ha);
+    printAST(a.program, 0, locations);
+    std::cout.rdbuf(&hb);
+    printAST(b.program, 0, locations);
+    std::cout.rdbuf(saved);
+    return ha.hash == hb.hash;
+}
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    std::string input(reinterpret_cast<const char*>(data), size);
+    Outcome reference, packedResult, parallelResult, consedResult;
+    {
+        // Only lexing and parsing are timed; printing is not linear in the input.
+        Watchdog watchdog(size, kNsPerByte);
+        std::ostringstream diagnostics;
+        Lexer lexer(input);
+        lexer.setDiagnostics(diagnostics);
+        std::vector<Token> tokens = lexer.tokenize();
+        TokenBuffer packed;
+        lexer.reset(input);
+        lexer.tokenize(packed);
+
+        reference = attempt([&] { return Parser(tokens).parseProgram(); });
+        packedResult = attempt([&] { return Parser(packed).parseProgram(); });
+        parallelResult = attempt([&] { return Parser(packed).parseProgramParallel(kThreads, kChunkTokens); });
+        consedResult = attempt([&] {
+            Parser parser(packed);
+            parser.setHashConsing(true);
+            return parser.parseProgramParallel(kThreads, kChunkTokens);
+        });
+    }
+    SourceMap locations("input", input);
+    if (!same(reference, packedResult, &locations)) fuzzMismatch("Parser(TokenBuffer)", 0);
+    if (!same(reference, parallelResult, &locations)) fuzzMismatch("parseProgramParallel()", 0);
+    if (!same(reference, consedResult, nullptr)) fuzzMismatch("setHashConsing(true)", 0);
+    return 0;
+}
@@ -1,4 +1,6 @@
 #include "AST.h"
+#include "SourceMap.h"
+#include "Visitor.h"
 #include <iostream>
 #include <iomanip>
 
@@ -13,99 +15,130 @@ static const char* tokName(TokenType t) {
     }
 }
 
-void printAST(const StmtPtr& n, int indent){
-    if(!n){ pad(indent); std::cout << "(null)\n"; return; }
+// ---------- Teardown ----------
+// Non-null while some thread is draining its worklist; nested releases append to it.
+static thread_local std::vector<ExprPtr>* pendingRelease = nullptr;
 
-    switch(n->kind){
-        case NodeKind::Program: {
-            auto* p = static_cast<Program*>(n.get());
-            pad(indent); std::cout << "Program\n";
-            for (auto& it : p->items) printAST(it, indent+2);
-            break;
-        }
-        case NodeKind::FnDecl: {
-            auto* f = static_cast<FnDeclStmt*>(n.get());
-            pad(indent); std::cout << "FnDecl name=" << f->name;
-            if (f->returnType != TokenType::ERROR) std::cout << " return=" << tokName(f->returnType);
-            std::cout << "\n";
-            pad(indent+2); std::cout << "Params:\n";
-            for (auto& pr : f->params){
-                pad(indent+4); std::cout << tokName(pr.typeTok) << " " << pr.name << "\n";
-            }
-            pad(indent+2); std::cout << "Body:\n";
-            printAST(f->body, indent+4);
-            break;
-        }
-        case NodeKind::Block: {
-            auto* b = static_cast<BlockStmt*>(n.get());
-            pad(indent); std::cout << "Block\n";
-            for (auto& s : b->statements) printAST(s, indent+2);
-            break;
-        }
-        case NodeKind::VarDecl: {
-            auto* v = static_cast<VarDeclStmt*>(n.get());
-            pad(indent); std::cout << "VarDecl " << tokName(v->typeTok) << " " << v->name << " =\n";
-            printAST(std::make_shared<ExprStmt>(v->init), indent+2);
-            break;
-        }
-        case NodeKind::ReturnStmt: {
-            auto* r = static_cast<ReturnStmt*>(n.get());
-            pad(indent); std::cout << "Return\n";
-            printAST(std::make_shared<ExprStmt>(r->expr), indent+2);
-            break;
-        }
-        case NodeKind::ExprStmt: {
-            auto* e = static_cast<ExprStmt*>(n.get());
-            // inline dispatch for expressions
-            auto& x = e->expr;
-            switch(x->kind){
-                case NodeKind::Identifier: {
-                    auto* i = static_cast<IdentExpr*>(x.get());
-                    pad(indent); std::cout << "Ident \"" << i->name << "\"\n"; break;
-                }
-                case NodeKind::IntLit: {
-                    auto* i = static_cast<IntLitExpr*>(x.get());
-                    pad(indent); std::cout << "Int " << i->value << "\n"; break;
-                }
-                case NodeKind::FloatLit: {
-                    auto* i = static_cast<FloatLitExpr*>(x.get());
-                    pad(indent); std::cout << "Float " << i->value << "\n"; break;
-                }
-                case NodeKind::StringLit: {
-                    auto* s = static_cast<StringLitExpr*>(x.get());
-                    pad(indent); std::cout << "String \"" << s->value << "\"\n"; break;
-                }
-                case NodeKind::Unary: {
-                    auto* u = static_cast<UnaryExpr*>(x.get());
-                    pad(indent); std::cout << "Unary(" << (int)u->op << ")\n";
-                    printAST(std::make_shared<ExprStmt>(u->expr), indent+2);
-                    break;
-                }
-                case NodeKind::Binary: {
-                    auto* b = static_cast<BinaryExpr*>(x.get());
-                    pad(indent); std::cout << "Binary(" << (int)b->op << ")\n";
-                    printAST(std::make_shared<ExprStmt>(b->left), indent+2);
-                    printAST(std::make_shared<ExprStmt>(b->right), indent+2);
-                    break;
-                }
-                case NodeKind::Call: {
-                    auto* c = static_cast<CallExpr*>(x.get());
-                    pad(indent); std::cout << "Call \"" << c->callee << "\"\n";
-                    pad(indent+2); std::cout << "Args:\n";
-                    for (auto& a : c->args)
-                        printAST(std::make_shared<ExprStmt>(a), indent+4);
-                    break;
-                }
-                default:
-                    pad(indent); std::cout << "(unknown expr kind)\n"; break;
-            }
-            break;
+void releaseExpr(ExprPtr& e){
+    if (!e) return;
+    if (e.use_count() != 1) { e.reset(); return; }   // still shared: nothing gets freed
+    if (pendingRelease) { pendingRelease->push_back(std::move(e)); return; }
+
+    std::vector<ExprPtr> work;
+    pendingRelease = &work;
+    work.push_back(std::move(e));
+    while (!work.empty()){
+        ExprPtr next = std::move(work.back());
+        work.pop_back();
+        next.reset();   // the node's destructor hands its children back to `work`
+    }
+    pendingRelease = nullptr;
+}
+
+// ---------- Printer ----------
+namespace {
+struct PrintItem {
+    const Stmt* stmt;   // exactly one of stmt / expr is set, or neither for "(null)"
+    const Expr* expr;
+    int indent;
+};
+
+// Prints one node and queues its children on `work` (last pushed = printed next).
+struct AstPrinter : ExprVisitor<AstPrinter>, StmtVisitor<AstPrinter> {
+    std::vector<PrintItem>& work;
+    const SourceMap* locations;
+    AstPrinter(std::vector<PrintItem>& w, const SourceMap* l) : work(w), locations(l) {}
+
+    // ends a node's header line
+    void endLine(uint32_t loc){
+        if (locations) std::cout << " @ " << locations->format(loc);
+        std::cout << "\n";
+    }
+
+    void child(const Stmt* s, int indent) { work.push_back({s, nullptr, indent}); }
+    void child(const Expr* e, int indent) { work.push_back({nullptr, e, indent}); }
+
+    // expressions
+    void visitIdentifier(const IdentExpr& i, int indent){
+        pad(indent); std::cout << "Ident \"" << i.name << "\""; endLine(i.loc);
+    }
+    void visitIntLit(const IntLitExpr& i, int indent){
+        pad(indent); std::cout << "Int " << i.value; endLine(i.loc);
+    }
+    void visitFloatLit(const FloatLitExpr& f, int indent){
+        pad(indent); std::cout << "Float " << f.value; endLine(f.loc);
+    }
+    void visitStringLit(const StringLitExpr& s, int indent){
+        pad(indent); std::cout << "String \"" << s.value << "\""; endLine(s.loc);
+    }
+    void visitUnary(const UnaryExpr& u, int indent){
+        pad(indent); std::cout << "Unary(" << (int)u.op << ")"; endLine(u.loc);
+        child(u.expr.get(), indent+2);
+    }
+    void visitBinary(const BinaryExpr& b, int indent){
+        pad(indent); std::cout << "Binary(" << (int)b.op << ")"; endLine(b.loc);
+        child(b.right.get(), indent+2);
+        child(b.left.get(), indent+2);
+    }
+    void visitCall(const CallExpr& c, int indent){
+        pad(indent); std::cout << "Call \"" << c.callee << "\""; endLine(c.loc);
+        pad(indent+2); std::cout << "Args:\n";
+        for (auto it = c.args.rbegin(); it != c.args.rend(); ++it) child(it->get(), indent+4);
+    }
+    void visitUnknownExpr(const Expr&, int indent){
+        pad(indent); std::cout << "(unknown expr kind)\n";
+    }
+
+    // statements
+    void visitProgram(const Program& p, int indent){
+        pad(indent); std::cout << "Program"; endLine(p.loc);
+        for (auto it = p.items.rbegin(); it != p.items.rend(); ++it) child(it->get(), indent+2);
+    }
+    void visitFnDecl(const FnDeclStmt& f, int indent){
+        pad(indent); std::cout << "FnDecl name=" << f.name;
+        if (f.returnType != TokenType::ERROR) std::cout << " return=" << tokName(f.returnType);
+        endLine(f.loc);
+        pad(indent+2); std::cout << "Params:\n";
+        for (auto& pr : f.params){
+            pad(indent+4); std::cout << tokName(pr.typeTok) << " " << pr.name << "\n";
         }
-        default:
-            pad(indent); std::cout << "(unknown stmt kind)\n"; break;
+        pad(indent+2); std::cout << "Body:\n";
+        child(f.body.get(), indent+4);
     }
+    void visitBlock(const BlockStmt& b, int indent){
+        pad(indent); std::cout << "Block"; endLine(b.loc);
+        for (auto it = b.statements.rbegin(); it != b.statements.rend(); ++it) child(it->get(), indent+2);
+    }
+    void visitVarDecl(const VarDeclStmt& v, int indent){
+        pad(indent); std::cout << "VarDecl " << tokName(v.typeTok) << " " << v.name << " ="; endLine(v.loc);
+        child(v.init.get(), indent+2);
+    }
+    void visitReturn(const ReturnStmt& r, int indent){
+        pad(indent); std::cout << "Return"; endLine(r.loc);
+        child(r.expr.get(), indent+2);
+    }
+    void visitExprStmt(const ExprStmt& e, int indent){
+        // expression statements print as their expression
+        child(e.expr.get(), indent);
+    }
+    void visitUnknownStmt(const Stmt&, int indent){
+        pad(indent); std::cout << "(unknown stmt kind)\n";
+    }
+};
 }
 
-void printAST(const std::vector<StmtPtr>& nodes, int indent){
-    for (auto& n : nodes) printAST(n, indent);
+void printAST(const StmtPtr& n, int indent, const SourceMap* locations){
+    std::vector<PrintItem> work;
+    AstPrinter printer(work, locations);
+    work.push_back({n.get(), nullptr, indent});
+    while (!work.empty()){
+        PrintItem item = work.back();
+        work.pop_back();
+        if (item.stmt) printer.visitStmt(*item.stmt, item.indent);
+        else if (item.expr) printer.visitExpr(*item.expr, item.indent);
+        else { pad(item.indent); std::cout << "(null)\n"; }
+    }
+}
+void printAST(const std::vector<StmtPtr>& nodes, int indent, const SourceMap* locations){
+    for (auto& n : nodes) printAST(n, indent, locations);
 }
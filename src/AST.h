@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -7,6 +8,7 @@
 // ---------- AST Base ----------
 struct Expr;
 struct Stmt;
+class SourceMap;
 
 using ExprPtr = std::shared_ptr<Expr>;
 using StmtPtr = std::shared_ptr<Stmt>;
@@ -18,24 +20,39 @@ enum class NodeKind {
     VarDecl, ReturnStmt, ExprStmt, Block, FnDecl, Program
 };
 
+// Nodes are non-polymorphic: passes dispatch on `kind` (see Visitor.h), and
+// shared_ptr's deleter destroys the concrete type, so no vtable is needed.
+// The protected destructor keeps anyone from deleting through a base pointer.
+// `loc` is a source offset (see SourceMap.h): the operator of a Binary/Unary,
+// the callee name of a Call, otherwise the node's first token.
 struct Expr {
     NodeKind kind;
+    uint32_t loc = 0;
     explicit Expr(NodeKind k) : kind(k) {}
-    virtual ~Expr() = default;
+protected:
+    ~Expr() = default;
 };
 
 struct Stmt {
     NodeKind kind;
+    uint32_t loc = 0;
     explicit Stmt(NodeKind k) : kind(k) {}
-    virtual ~Stmt() = default;
+protected:
+    ~Stmt() = default;
 };
 
+// Drops one reference to a child expression. If that was the last reference the
+// subtree is torn down from a worklist rather than by nested destructor calls, so
+// freeing a very deep tree does not overflow the stack.
+void releaseExpr(ExprPtr& e);
+
 // ---------- Expr Nodes ----------
 struct BinaryExpr : Expr {
     TokenType op;
     ExprPtr left, right;
     BinaryExpr(TokenType op, ExprPtr l, ExprPtr r)
         : Expr(NodeKind::Binary), op(op), left(std::move(l)), right(std::move(r)) {}
+    ~BinaryExpr() { releaseExpr(left); releaseExpr(right); }
 };
 
 struct UnaryExpr : Expr {
@@ -43,6 +60,7 @@ struct UnaryExpr : Expr {
     ExprPtr expr;
     UnaryExpr(TokenType op, ExprPtr e)
         : Expr(NodeKind::Unary), op(op), expr(std::move(e)) {}
+    ~UnaryExpr() { releaseExpr(expr); }
 };
 
 struct IdentExpr : Expr {
@@ -74,6 +92,7 @@ struct CallExpr : Expr {
     std::vector<ExprPtr> args;
     CallExpr(std::string c, std::vector<ExprPtr> a)
         : Expr(NodeKind::Call), callee(std::move(c)), args(std::move(a)) {}
+    ~CallExpr() { for (auto& a : args) releaseExpr(a); }
 };
 
 // ---------- Stmt Nodes ----------
@@ -124,5 +143,7 @@ struct Program : Stmt {
 };
 
 // ---------- AST Pretty Printer ----------
-void printAST(const StmtPtr& node, int indent = 0);
-void printAST(const std::vector<StmtPtr>& nodes, int indent = 0);
+// Walks the tree with an explicit stack; output is the same at any depth.
+// With a SourceMap, every node line ends in " @ file:line:col".
+void printAST(const StmtPtr& node, int indent = 0, const SourceMap* locations = nullptr);
+void printAST(const std::vector<StmtPtr>& nodes, int indent = 0, const SourceMap* locations = nullptr);
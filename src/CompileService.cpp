@@ -0,0 +1,171 @@
+#include "CompileService.h"
+#include "Parser.h"
+#include "SourceMap.h"
+#include <stdexcept>
+
+// ---------- LatencyHistogram ----------
+LatencyHistogram::LatencyHistogram() {
+    for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+}
+
+int LatencyHistogram::bucketOf(uint64_t v) {
+    if (v < (1u << kSubBits)) return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    int sub = (int)((v >> (msb - kSubBits)) & ((1u << kSubBits) - 1));
+    return ((msb - kSubBits + 1) << kSubBits) | sub;
+}
+
+uint64_t LatencyHistogram::bucketUpper(int idx) {
+    if (idx < (1 << kSubBits)) return (uint64_t)idx;
+    int msb = (idx >> kSubBits) + kSubBits - 1;
+    uint64_t sub = (uint64_t)(idx & ((1 << kSubBits) - 1));
+    int shift = msb - kSubBits;
+    uint64_t lower = ((uint64_t(1) << kSubBits) | sub) << shift;
+    return lower + ((uint64_t(1) << shift) - 1);
+}
+
+void LatencyHistogram::record(uint64_t nanos) {
+    buckets[bucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::count() const {
+    uint64_t n = 0;
+    for (auto& b : buckets) n += b.load(std::memory_order_relaxed);
+    return n;
+}
+
+double LatencyHistogram::percentileMicros(double q) const {
+    uint64_t total = count();
+    if (total == 0) return 0;
+    uint64_t rank = (uint64_t)(q * (double)(total - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; ++i) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) return (double)bucketUpper(i) / 1000.0;
+    }
+    return (double)bucketUpper(kBuckets - 1) / 1000.0;
+}
+
+// ---------- CompileService ----------
+CompileService::CompileService(unsigned workerCount, size_t queueCapacity)
+    : queue(queueCapacity), started(Clock::now()) {
+    if (workerCount == 0) workerCount = 1;
+    for (unsigned i = 0; i < workerCount; ++i) {
+        workers.push_back(std::make_unique<Worker>());
+        Worker& w = *workers.back();
+        w.lexer.setDiagnostics(w.diagnostics);
+        w.thread = std::thread([this, &w] { run(w); });
+    }
+}
+
+CompileService::~CompileService() { shutdown(); }
+
+std::future<CompileResult> CompileService::submit(std::string source) {
+    // Announce the submit before checking `stopping`; run() checks the two in
+    // the opposite order (both seq_cst), so either this call sees the shutdown
+    // or a worker sees this call and stays up to pop its request.
+    submitting.fetch_add(1);
+    struct Leave {
+        std::atomic<unsigned>& n;
+        ~Leave() { n.fetch_sub(1); }
+    } leave{submitting};
+    if (stopping.load())
+        throw std::runtime_error("CompileService: submit after shutdown");
+    Request req;
+    req.source = std::move(source);
+    req.enqueued = Clock::now();
+    std::future<CompileResult> fut = req.reply.get_future();
+    for (unsigned spins = 0; !queue.tryPush(req); ++spins) {
+        if (spins > 64) std::this_thread::yield();
+    }
+    // An RMW rather than a load, ordered against park()'s increment: either it
+    // reads that worker as asleep, or that worker's increment reads this one and
+    // its tryPop sees the request.
+    if (sleepers.fetch_add(0) > 0) {
+        { std::lock_guard<std::mutex> lock(parkMutex); }
+        wakeup.notify_one();
+    }
+    return fut;
+}
+
+void CompileService::shutdown() {
+    stopping.store(true);
+    { std::lock_guard<std::mutex> lock(parkMutex); }
+    wakeup.notify_all();
+    for (auto& w : workers) {
+        if (w->thread.joinable()) w->thread.join();
+    }
+}
+
+bool CompileService::park(Request& req) {
+    std::unique_lock<std::mutex> lock(parkMutex);
+    sleepers.fetch_add(1);
+    bool popped;
+    while (!(popped = queue.tryPop(req)) && !stopping.load()) wakeup.wait(lock);
+    sleepers.fetch_sub(1);
+    return popped;
+}
+
+void CompileService::run(Worker& w) {
+    Request req;
+    unsigned idle = 0;
+    while (true) {
+        if (!queue.tryPop(req)) {
+            // queue drained: exit once shutdown was requested and no submit() can
+            // still push, otherwise back off
+            if (stopping.load() && submitting.load() == 0) {
+                if (!queue.tryPop(req)) return;
+            } else if (++idle < 64) {
+                continue;
+            } else if (idle < 256 || stopping.load()) {
+                // while shutting down only in-flight submit() calls are left to wait for
+                std::this_thread::yield();
+                continue;
+            } else if (!park(req)) {
+                continue;
+            }
+        }
+        idle = 0;
+
+        CompileResult res = compile(w, req.source);
+        uint64_t nanos = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - req.enqueued).count();
+        latency.record(nanos);
+        completed.fetch_add(1, std::memory_order_relaxed);
+        // the next tryPop() move-assigns over `req`, so no fresh promise state is made here
+        req.reply.set_value(std::move(res));
+    }
+}
+
+CompileResult CompileService::compile(Worker& w, const std::string& source) {
+    CompileResult res;
+    SourceMap locations("<input>", source);   // line table only built if something is reported
+    try {
+        w.diagnostics.str(std::string());
+        w.lexer.reset(source);
+        w.lexer.setSourceMap(&locations);
+        w.lexer.tokenize(w.tokens);
+        w.lexer.setSourceMap(nullptr);
+        res.diagnostics = w.diagnostics.str();
+        res.tokenCount = w.tokens.size();
+        Parser parser(w.tokens);
+        res.program = parser.parseProgram();
+        res.ok = true;
+    } catch (const ParseException& ex) {
+        res.error = std::string("Parse error: ") + ex.what();
+        if (ex.offset) res.error = locations.format(*ex.offset) + ": " + res.error;
+    } catch (const std::exception& ex) {
+        res.error = std::string("Error: ") + ex.what();
+    }
+    return res;
+}
+
+ServiceMetrics CompileService::metrics() const {
+    ServiceMetrics m;
+    m.completed = completed.load(std::memory_order_relaxed);
+    m.elapsedSeconds = std::chrono::duration<double>(Clock::now() - started).count();
+    m.throughput = m.elapsedSeconds > 0 ? (double)m.completed / m.elapsedSeconds : 0;
+    m.p50Micros = latency.percentileMicros(0.50);
+    m.p99Micros = latency.percentileMicros(0.99);
+    return m;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "lexer.h"
+#include "AST.h"
+#include "MpmcQueue.h"
+
+// ---------- Compile service ----------
+// A fixed pool of workers fed through a lock-free queue. Each worker keeps its
+// Lexer, token buffer and diagnostics stream between requests, so in steady
+// state a request allocates only the reply state submit() creates for its
+// future and the CompileResult it returns (the AST and any messages).
+// Idle workers spin, then yield, then park on a condition variable until
+// submit() or shutdown() wakes them.
+
+struct CompileResult {
+    bool ok = false;
+    std::string error;                  // diagnostic when !ok
+    std::string diagnostics;            // lexer warnings ("Invalid token ..."), even when ok
+    size_t tokenCount = 0;
+    std::shared_ptr<Program> program;   // set when ok
+};
+
+struct ServiceMetrics {
+    uint64_t completed = 0;
+    double elapsedSeconds = 0;          // since the service started
+    double throughput = 0;              // completed requests per second
+    double p50Micros = 0;               // queue wait + compile time
+    double p99Micros = 0;
+};
+
+// Log-linear latency histogram (8 sub-buckets per power of two, ~12% resolution).
+// Recording is a single relaxed atomic increment, so workers never contend on a lock.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+    void record(uint64_t nanos);
+    uint64_t count() const;
+    double percentileMicros(double q) const;   // q in [0, 1]; upper bound of the bucket
+
+private:
+    static constexpr int kSubBits = 3;
+    static constexpr int kBuckets = (64 - kSubBits + 1) << kSubBits;
+    static int bucketOf(uint64_t v);
+    static uint64_t bucketUpper(int idx);
+
+    std::atomic<uint64_t> buckets[kBuckets];
+};
+
+class CompileService {
+public:
+    explicit CompileService(unsigned workers, size_t queueCapacity = 4096);
+    ~CompileService();
+    CompileService(const CompileService&) = delete;
+    CompileService& operator=(const CompileService&) = delete;
+
+    // Queues a request. Blocks (spinning, then yielding) while the queue is full;
+    // throws std::runtime_error once shutdown() has been called. A request that
+    // got past that check is always compiled: workers keep draining until no
+    // submit() is in flight.
+    std::future<CompileResult> submit(std::string source);
+
+    // Stops accepting work, lets workers drain the queue and joins them.
+    void shutdown();
+
+    ServiceMetrics metrics() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Request {
+        std::string source;
+        std::promise<CompileResult> reply;
+        Clock::time_point enqueued;
+    };
+
+    // Per-worker state reused from one request to the next.
+    struct Worker {
+        Lexer lexer;
+        TokenBuffer tokens;
+        std::ostringstream diagnostics;   // the lexer's sink, emptied per request
+        std::thread thread;
+    };
+
+    void run(Worker& w);
+    // Sleeps until a request can be popped into `req` (returns true) or
+    // shutdown() was called (returns false).
+    bool park(Request& req);
+    CompileResult compile(Worker& w, const std::string& source);
+
+    MpmcQueue<Request> queue;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> stopping{false};
+    std::atomic<unsigned> submitting{0};   // submit() calls between their check and push
+    std::atomic<unsigned> sleepers{0};     // workers inside park()
+    std::mutex parkMutex;
+    std::condition_variable wakeup;
+    std::atomic<uint64_t> completed{0};
+    LatencyHistogram latency;
+    Clock::time_point started;
+};
@@ -0,0 +1,145 @@
+#include "ExprInterner.h"
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+
+namespace {
+
+size_t mix(size_t seed, size_t v) {
+    return seed ^ (v + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+size_t hashPtr(const ExprPtr& p) { return std::hash<const Expr*>()(p.get()); }
+
+// Floats compare by bit pattern, so 0.0 and -0.0 stay distinct and NaN matches itself.
+uint64_t floatBits(double d) {
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof bits);
+    return bits;
+}
+
+// Heap owned by a string beyond the object itself (0 while it fits the SSO buffer).
+size_t stringHeap(const std::string& s) {
+    const char* data = s.data();
+    const char* self = reinterpret_cast<const char*>(&s);
+    return data >= self && data < self + sizeof s ? 0 : s.capacity() + 1;
+}
+
+// Bytes freed when a duplicate node is dropped: the make_shared block (node plus
+// control block, counted as two pointers) and any buffers the node owns. Its
+// children are canonical already, so they live on.
+size_t nodeBytes(const Expr& e) {
+    const size_t control = 2 * sizeof(void*);
+    switch (e.kind) {
+        case NodeKind::Binary:     return control + sizeof(BinaryExpr);
+        case NodeKind::Unary:      return control + sizeof(UnaryExpr);
+        case NodeKind::IntLit:     return control + sizeof(IntLitExpr);
+        case NodeKind::FloatLit:   return control + sizeof(FloatLitExpr);
+        case NodeKind::Identifier:
+            return control + sizeof(IdentExpr) + stringHeap(static_cast<const IdentExpr&>(e).name);
+        case NodeKind::StringLit:
+            return control + sizeof(StringLitExpr) + stringHeap(static_cast<const StringLitExpr&>(e).value);
+        case NodeKind::Call: {
+            auto& c = static_cast<const CallExpr&>(e);
+            return control + sizeof(CallExpr) + stringHeap(c.callee) + c.args.capacity() * sizeof(ExprPtr);
+        }
+        default:                   return 0;
+    }
+}
+
+// One unordered_set entry: the next pointer, the stored ExprPtr and the cached
+// hash (kept because Hash is not trivially cheap). Buckets are counted separately.
+constexpr size_t kEntryBytes = sizeof(void*) + sizeof(ExprPtr) + sizeof(size_t);
+
+} // namespace
+
+size_t ExprInterner::Hash::operator()(const ExprPtr& p) const {
+    const Expr& e = *p;
+    size_t h = std::hash<int>()((int)e.kind);
+    switch (e.kind) {
+        case NodeKind::Binary: {
+            auto& b = static_cast<const BinaryExpr&>(e);
+            return mix(mix(mix(h, (size_t)b.op), hashPtr(b.left)), hashPtr(b.right));
+        }
+        case NodeKind::Unary: {
+            auto& u = static_cast<const UnaryExpr&>(e);
+            return mix(mix(h, (size_t)u.op), hashPtr(u.expr));
+        }
+        case NodeKind::Identifier:
+            return mix(h, std::hash<std::string>()(static_cast<const IdentExpr&>(e).name));
+        case NodeKind::IntLit:
+            return mix(h, std::hash<long long>()(static_cast<const IntLitExpr&>(e).value));
+        case NodeKind::FloatLit:
+            return mix(h, std::hash<uint64_t>()(floatBits(static_cast<const FloatLitExpr&>(e).value)));
+        case NodeKind::StringLit:
+            return mix(h, std::hash<std::string>()(static_cast<const StringLitExpr&>(e).value));
+        case NodeKind::Call: {
+            auto& c = static_cast<const CallExpr&>(e);
+            h = mix(h, std::hash<std::string>()(c.callee));
+            for (auto& a : c.args) h = mix(h, hashPtr(a));
+            return h;
+        }
+        default:
+            return mix(h, hashPtr(p));   // unknown kinds are never merged
+    }
+}
+
+bool ExprInterner::Equal::operator()(const ExprPtr& pa, const ExprPtr& pb) const {
+    const Expr& a = *pa;
+    const Expr& b = *pb;
+    if (a.kind != b.kind) return false;
+    switch (a.kind) {
+        case NodeKind::Binary: {
+            auto& x = static_cast<const BinaryExpr&>(a);
+            auto& y = static_cast<const BinaryExpr&>(b);
+            return x.op == y.op && x.left == y.left && x.right == y.right;
+        }
+        case NodeKind::Unary: {
+            auto& x = static_cast<const UnaryExpr&>(a);
+            auto& y = static_cast<const UnaryExpr&>(b);
+            return x.op == y.op && x.expr == y.expr;
+        }
+        case NodeKind::Identifier:
+            return static_cast<const IdentExpr&>(a).name == static_cast<const IdentExpr&>(b).name;
+        case NodeKind::IntLit:
+            return static_cast<const IntLitExpr&>(a).value == static_cast<const IntLitExpr&>(b).value;
+        case NodeKind::FloatLit:
+            return floatBits(static_cast<const FloatLitExpr&>(a).value) ==
+                   floatBits(static_cast<const FloatLitExpr&>(b).value);
+        case NodeKind::StringLit:
+            return static_cast<const StringLitExpr&>(a).value == static_cast<const StringLitExpr&>(b).value;
+        case NodeKind::Call: {
+            auto& x = static_cast<const CallExpr&>(a);
+            auto& y = static_cast<const CallExpr&>(b);
+            return x.callee == y.callee && x.args == y.args;   // element-wise pointer comparison
+        }
+        default:
+            return &a == &b;
+    }
+}
+
+ExprPtr ExprInterner::intern(ExprPtr e) {
+    Shard& shard = shards[Hash()(e) % kShards];
+    std::lock_guard<std::mutex> guard(shard.lock);
+    ++shard.counts.requested;
+    auto [it, inserted] = shard.nodes.insert(e);
+    if (inserted) {
+        ++shard.counts.unique;
+        return e;
+    }
+    shard.counts.duplicateBytes += nodeBytes(*e);
+    const ExprPtr& canonical = *it;
+    if (e->loc < canonical->loc) canonical->loc = e->loc;
+    return canonical;
+}
+
+InternStats ExprInterner::stats() const {
+    InternStats total;
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        total += shard.counts;
+        total.tableBytes += shard.nodes.size() * kEntryBytes + shard.nodes.bucket_count() * sizeof(void*);
+    }
+    return total;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <mutex>
+#include <unordered_set>
+#include "AST.h"
+
+// ---------- Hash-consing ----------
+// Maps every structurally distinct expression to one shared node. The parser
+// interns children before their parent, so a node's identity is its kind, its
+// operator / literal / name, and the addresses of its children; two interned
+// subtrees are equal exactly when their root pointers are. This is sound only
+// because expressions have no side effects (calls included).
+// A shared node keeps the smallest `loc` among its occurrences, i.e. the first
+// one in the source. Safe to use from several parsing threads at once.
+// The table holds a reference to every unique node, so it keeps them alive
+// until it is destroyed, even after the AST that used them is gone.
+
+struct InternStats {
+    size_t requested = 0;        // expression nodes the parser built
+    size_t unique = 0;           // nodes kept
+    size_t duplicateBytes = 0;   // heap bytes of the duplicates that were dropped
+    size_t tableBytes = 0;       // the interning table itself, while it exists
+
+    // Net saving: the duplicates dropped minus what the table costs. Negative
+    // when there were too few duplicates to pay for the table.
+    long long bytesSaved() const { return (long long)duplicateBytes - (long long)tableBytes; }
+
+    InternStats& operator+=(const InternStats& o) {
+        requested += o.requested;
+        unique += o.unique;
+        duplicateBytes += o.duplicateBytes;
+        tableBytes += o.tableBytes;
+        return *this;
+    }
+};
+
+class ExprInterner {
+public:
+    ExprInterner() = default;
+    ExprInterner(const ExprInterner&) = delete;
+    ExprInterner& operator=(const ExprInterner&) = delete;
+
+    // Returns the canonical node equal to `e` (whose children must already be
+    // interned), adding `e` itself if it is the first of its kind.
+    ExprPtr intern(ExprPtr e);
+    InternStats stats() const;
+
+private:
+    struct Hash { size_t operator()(const ExprPtr& e) const; };
+    struct Equal { bool operator()(const ExprPtr& a, const ExprPtr& b) const; };
+
+    static constexpr size_t kShards = 16;   // one lock each, picked by hash
+
+    struct Shard {
+        mutable std::mutex lock;
+        std::unordered_set<ExprPtr, Hash, Equal> nodes;
+        InternStats counts;
+    };
+    Shard shards[kShards];
+};
@@ -0,0 +1,723 @@
+#include "Interpreter.h"
+#include "Visitor.h"
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <sstream>
+
+// ---------- Values ----------
+std::string valueToString(const Value& v){
+    if (auto* i = std::get_if<long long>(&v)) return std::to_string(*i);
+    if (auto* d = std::get_if<double>(&v)) { std::ostringstream os; os << *d; return os.str(); }
+    return std::get<std::string>(v);
+}
+
+static const char* typeName(const Value& v){
+    switch (v.index()){
+        case 0:  return "int";
+        case 1:  return "float";
+        default: return "string";
+    }
+}
+
+static const char* opName(TokenType op){
+    switch (op){
+        case TokenType::ADDOP:    return "+";
+        case TokenType::SUBOP:    return "-";
+        case TokenType::MULOP:    return "*";
+        case TokenType::DIVOP:    return "/";
+        case TokenType::EQUALSOP: return "==";
+        default:                  return "?";
+    }
+}
+
+// Converts `v` to a declared type (TokenType::ERROR = undeclared, left as is).
+static Value coerce(Value v, TokenType type, const std::string& what, uint32_t at){
+    switch (type){
+        case TokenType::INT:
+            if (auto* d = std::get_if<double>(&v)){
+                // truncation is only defined in [-2^63, 2^63); NaN fails both tests
+                if (!(*d >= -9223372036854775808.0 && *d < 9223372036854775808.0))
+                    throw RuntimeError("Value error: float " + valueToString(v) + " does not fit int for " + what, at);
+                return (long long)*d;
+            }
+            break;
+        case TokenType::FLOAT:
+            if (auto* i = std::get_if<long long>(&v)) return (double)*i;
+            break;
+        default:
+            return v;
+    }
+    bool isString = std::holds_alternative<std::string>(v);
+    bool wantString = type == TokenType::STRING;
+    if (isString != wantString)
+        throw RuntimeError("Type error: cannot use " + std::string(typeName(v)) + " as "
+                           + (type == TokenType::INT ? "int" : type == TokenType::FLOAT ? "float" : "string")
+                           + " for " + what, at);
+    return v;
+}
+
+static Value negate(const Value& v, uint32_t at){
+    if (auto* i = std::get_if<long long>(&v)) return (long long)(0ULL - (unsigned long long)*i);
+    if (auto* d = std::get_if<double>(&v)) return -*d;
+    throw RuntimeError("Type error: cannot negate a string", at);
+}
+
+static Value binary(TokenType op, const Value& a, const Value& b, size_t maxString, uint32_t at){
+    bool aStr = std::holds_alternative<std::string>(a), bStr = std::holds_alternative<std::string>(b);
+    if (op == TokenType::EQUALSOP){
+        if (aStr || bStr) return (long long)(aStr && bStr && std::get<std::string>(a) == std::get<std::string>(b));
+        if (a.index() == 0 && b.index() == 0) return (long long)(std::get<long long>(a) == std::get<long long>(b));
+        double x = a.index() == 0 ? (double)std::get<long long>(a) : std::get<double>(a);
+        double y = b.index() == 0 ? (double)std::get<long long>(b) : std::get<double>(b);
+        return (long long)(x == y);
+    }
+    if (aStr && bStr && op == TokenType::ADDOP){
+        const std::string& x = std::get<std::string>(a);
+        const std::string& y = std::get<std::string>(b);
+        if (x.size() + y.size() > maxString)
+            throw RuntimeError("String too long: limit is " + std::to_string(maxString) + " bytes", at);
+        return x + y;
+    }
+    if (aStr || bStr)
+        throw RuntimeError(std::string("Type error: cannot apply '") + opName(op) + "' to "
+                           + typeName(a) + " and " + typeName(b), at);
+
+    if (a.index() == 0 && b.index() == 0){
+        // two's complement wraparound instead of signed-overflow UB
+        unsigned long long x = (unsigned long long)std::get<long long>(a);
+        unsigned long long y = (unsigned long long)std::get<long long>(b);
+        switch (op){
+            case TokenType::ADDOP: return (long long)(x + y);
+            case TokenType::SUBOP: return (long long)(x - y);
+            case TokenType::MULOP: return (long long)(x * y);
+            case TokenType::DIVOP: {
+                long long n = std::get<long long>(a), d = std::get<long long>(b);
+                if (d == 0) throw RuntimeError("Division by zero", at);
+                if (n == LLONG_MIN && d == -1) return n;
+                return n / d;
+            }
+            default: break;
+        }
+    } else {
+        double x = a.index() == 0 ? (double)std::get<long long>(a) : std::get<double>(a);
+        double y = b.index() == 0 ? (double)std::get<long long>(b) : std::get<double>(b);
+        switch (op){
+            case TokenType::ADDOP: return x + y;
+            case TokenType::SUBOP: return x - y;
+            case TokenType::MULOP: return x * y;
+            case TokenType::DIVOP: return x / y;
+            default: break;
+        }
+    }
+    throw RuntimeError(std::string("Unknown operator '") + opName(op) + "'", at);
+}
+
+// ---------- Engine state ----------
+struct ExecutionEngine::Function {
+    const FnDeclStmt* decl;
+    uint64_t calls = 0;
+    bool optimized = false;
+    bool optimizable = true;        // false when an expression is too deep for tier 1
+    size_t nodes = 0;               // AST size, checked against the inlining budget
+    std::vector<OptStep> code;      // tier 1 body
+    size_t frameSize = 0;
+};
+
+// Tier 1 expression: locals are frame slots, calls hold their callee directly.
+struct ExecutionEngine::OptExpr {
+    enum Op { Const, Local, Global, Neg, Binary, Call, Inline } op;
+    uint32_t loc = 0;               // the AST node's; Inline: its return statement's
+    Value value;                    // Const
+    size_t slot = 0;                // Local
+    std::string name;               // Global / Call (for diagnostics)
+    TokenType type = TokenType::ERROR;  // Binary: operator; Inline: callee return type
+    Function* fn = nullptr;         // Call (nullptr: undefined function)
+    std::vector<OptExpr*> kids;     // operands / call args / Inline result (see newOptExpr)
+    std::vector<OptStep> steps;     // Inline: the callee body, run in the caller's frame
+};
+
+struct ExecutionEngine::OptStep {
+    enum Kind { SetLocal, Eval, Return } kind;
+    size_t slot = 0;
+    TokenType type = TokenType::ERROR;  // coercion applied to the value
+    std::string what;                   // what is being coerced, for diagnostics
+    OptExpr* expr = nullptr;
+    uint32_t loc = 0;                   // reported by a failed coercion
+};
+
+ExecutionEngine::ExecutionEngine(std::shared_ptr<Program> prog, EngineOptions options)
+    : program(std::move(prog)), opts(options) {}
+
+ExecutionEngine::~ExecutionEngine() = default;
+
+ExecutionEngine::Function* ExecutionEngine::lookup(const std::string& name) const {
+    auto it = byName.find(name);
+    return it == byName.end() ? nullptr : functions[it->second].get();
+}
+
+// Builds the function table in declaration order.
+void ExecutionEngine::layout(){
+    optBlocks.clear();
+    functions.clear();
+    byName.clear();
+    for (auto& item : program->items){
+        if (item->kind != NodeKind::FnDecl) continue;
+        auto fn = std::make_unique<Function>();
+        fn->decl = static_cast<const FnDeclStmt*>(item.get());
+        functions.push_back(std::move(fn));
+    }
+    for (size_t i = 0; i < functions.size(); ++i){
+        byName[functions[i]->decl->name] = i;   // later declarations win, as in tier 0
+    }
+    // measure every body once: node count for inlining, depth for tier 1 eligibility
+    for (auto& fn : functions){
+        std::vector<std::pair<const Expr*, size_t>> work;
+        fn->nodes = 1;
+        for (auto& st : fn->decl->body->statements){
+            ++fn->nodes;
+            const Expr* e = nullptr;
+            if (st->kind == NodeKind::VarDecl) e = static_cast<const VarDeclStmt*>(st.get())->init.get();
+            else if (st->kind == NodeKind::ReturnStmt) e = static_cast<const ReturnStmt*>(st.get())->expr.get();
+            else if (st->kind == NodeKind::ExprStmt) e = static_cast<const ExprStmt*>(st.get())->expr.get();
+            if (e) work.push_back({e, 1});
+        }
+        while (!work.empty()){
+            auto [e, d] = work.back();
+            work.pop_back();
+            ++fn->nodes;
+            if (d > kMaxOptimizedDepth) fn->optimizable = false;
+            if (e->kind == NodeKind::Binary){
+                auto* b = static_cast<const BinaryExpr*>(e);
+                work.push_back({b->left.get(), d + 1});
+                work.push_back({b->right.get(), d + 1});
+            } else if (e->kind == NodeKind::Unary){
+                work.push_back({static_cast<const UnaryExpr*>(e)->expr.get(), d + 1});
+            } else if (e->kind == NodeKind::Call){
+                for (auto& a : static_cast<const CallExpr*>(e)->args) work.push_back({a.get(), d + 1});
+            }
+        }
+    }
+}
+
+// ---------- Tier 0: AST walking ----------
+// Evaluates one expression with an explicit task stack, so deep expression
+// trees (long `a + b + ...` chains) do not recurse on the C++ stack.
+class ExecutionEngine::Tier0 : public ExprVisitor<Tier0> {
+public:
+    struct Task { const Expr* e; size_t stage; };
+
+    Tier0(ExecutionEngine& engine, const Env* locals) : eng(engine), env(locals) {}
+
+    Value run(const Expr& root){
+        tasks.push_back({&root, 0});
+        while (!tasks.empty()) visitExpr(*tasks.back().e, tasks.back());
+        return std::move(values.back());
+    }
+
+    void visitIntLit(const IntLitExpr& i, Task&)       { done(i.value); }
+    void visitFloatLit(const FloatLitExpr& f, Task&)   { done(f.value); }
+    void visitStringLit(const StringLitExpr& s, Task&) { done(s.value); }
+
+    void visitIdentifier(const IdentExpr& i, Task&){
+        if (env){
+            auto it = env->find(i.name);
+            if (it != env->end()) { done(it->second); return; }
+        }
+        auto g = eng.globals.find(i.name);
+        if (g == eng.globals.end()) throw RuntimeError("Undefined variable '" + i.name + "'", i.loc);
+        done(g->second);
+    }
+
+    void visitUnary(const UnaryExpr& u, Task& t){
+        if (t.stage++ == 0) { tasks.push_back({u.expr.get(), 0}); return; }
+        Value v = pop();
+        done(negate(v, u.loc));
+    }
+
+    void visitBinary(const BinaryExpr& b, Task& t){
+        switch (t.stage++){
+            case 0: tasks.push_back({b.left.get(), 0}); return;
+            case 1: tasks.push_back({b.right.get(), 0}); return;
+        }
+        Value r = pop();
+        Value l = pop();
+        done(binary(b.op, l, r, eng.opts.maxStringLength, b.loc));
+    }
+
+    void visitCall(const CallExpr& c, Task& t){
+        if (t.stage == 0 && !eng.lookup(c.callee))
+            throw RuntimeError("Undefined function '" + c.callee + "'", c.loc);
+        if (t.stage < c.args.size()) { tasks.push_back({c.args[t.stage++].get(), 0}); return; }
+        std::vector<Value> args(std::make_move_iterator(values.end() - (std::ptrdiff_t)c.args.size()),
+                                std::make_move_iterator(values.end()));
+        values.resize(values.size() - c.args.size());
+        done(eng.invoke(*eng.lookup(c.callee), std::move(args), c.loc));
+    }
+
+    void visitUnknownExpr(const Expr&, Task&){ throw RuntimeError("Unknown expression kind"); }
+
+private:
+    void done(Value v){ values.push_back(std::move(v)); tasks.pop_back(); }
+    Value pop(){ Value v = std::move(values.back()); values.pop_back(); return v; }
+
+    ExecutionEngine& eng;
+    const Env* env;
+    std::vector<Task> tasks;
+    std::vector<Value> values;
+};
+
+Value ExecutionEngine::eval(const Expr& e, const Env* locals){
+    return Tier0(*this, locals).run(e);
+}
+
+Value ExecutionEngine::runTier0(Function& fn, std::vector<Value>& args, uint32_t at){
+    const FnDeclStmt& d = *fn.decl;
+    Env env;
+    for (size_t i = 0; i < args.size(); ++i)
+        env[d.params[i].name] = coerce(std::move(args[i]), d.params[i].typeTok, "parameter '" + d.params[i].name + "'", at);
+
+    for (auto& st : d.body->statements){
+        switch (st->kind){
+            case NodeKind::VarDecl: {
+                auto* v = static_cast<const VarDeclStmt*>(st.get());
+                Value init = eval(*v->init, &env);
+                env[v->name] = coerce(std::move(init), v->typeTok, "variable '" + v->name + "'", v->loc);
+                break;
+            }
+            case NodeKind::ExprStmt:
+                eval(*static_cast<const ExprStmt*>(st.get())->expr, &env);
+                break;
+            case NodeKind::ReturnStmt:
+                return coerce(eval(*static_cast<const ReturnStmt*>(st.get())->expr, &env),
+                              d.returnType, "return value of '" + d.name + "'", st->loc);
+            default:
+                throw RuntimeError("Unsupported statement in '" + d.name + "'", st->loc);
+        }
+    }
+    return 0LL;
+}
+
+// ---------- Tier 1: slot-resolved, folded, inlined ----------
+class ExecutionEngine::Compiler : public ExprVisitor<Compiler, ExecutionEngine::OptExpr*> {
+public:
+    using Scope = std::unordered_map<std::string, size_t>;
+    using Ptr = OptExpr*;
+
+    explicit Compiler(ExecutionEngine& engine) : eng(engine) {}
+
+    void compile(Function& fn){
+        const FnDeclStmt& d = *fn.decl;
+        Scope params;
+        for (auto& p : d.params) params[p.name] = nextSlot++;
+        inlineStack.push_back(&fn);
+        scope = &params;
+        uint32_t returnLoc = 0;
+        Ptr result = body(d, fn.code, returnLoc);
+        if (result){
+            OptStep ret{OptStep::Return, 0, d.returnType, "return value of '" + d.name + "'", std::move(result), returnLoc};
+            fn.code.push_back(std::move(ret));
+        }
+        inlineStack.pop_back();
+        fn.frameSize = nextSlot;
+    }
+
+    Ptr visitIntLit(const IntLitExpr& i)       { return constant(i.value); }
+    Ptr visitFloatLit(const FloatLitExpr& f)   { return constant(f.value); }
+    Ptr visitStringLit(const StringLitExpr& s) { return constant(s.value); }
+
+    Ptr visitIdentifier(const IdentExpr& i){
+        auto e = eng.newOptExpr();
+        auto it = scope->find(i.name);
+        if (it != scope->end()) { e->op = OptExpr::Local; e->slot = it->second; }
+        else { e->op = OptExpr::Global; e->name = i.name; }
+        e->loc = i.loc;
+        return e;
+    }
+
+    Ptr visitUnary(const UnaryExpr& u){
+        Ptr operand = visitExpr(*u.expr);
+        if (operand->op == OptExpr::Const){
+            try { return constant(negate(operand->value, u.loc)); } catch (const RuntimeError&) {}
+        }
+        auto e = eng.newOptExpr();
+        e->op = OptExpr::Neg;
+        e->loc = u.loc;
+        e->kids.push_back(std::move(operand));
+        return e;
+    }
+
+    Ptr visitBinary(const BinaryExpr& b){
+        Ptr l = visitExpr(*b.left);
+        Ptr r = visitExpr(*b.right);
+        // fold only when evaluation succeeds; errors stay runtime errors
+        if (l->op == OptExpr::Const && r->op == OptExpr::Const){
+            try { return constant(binary(b.op, l->value, r->value, eng.opts.maxStringLength, b.loc)); } catch (const RuntimeError&) {}
+        }
+        auto e = eng.newOptExpr();
+        e->op = OptExpr::Binary;
+        e->loc = b.loc;
+        e->type = b.op;
+        e->kids.push_back(std::move(l));
+        e->kids.push_back(std::move(r));
+        return e;
+    }
+
+    Ptr visitCall(const CallExpr& c){
+        Function* callee = eng.lookup(c.callee);
+        auto e = eng.newOptExpr();
+        e->name = c.callee;
+        e->fn = callee;
+        e->loc = c.loc;
+        for (auto& a : c.args) e->kids.push_back(visitExpr(*a));
+        if (!callee || !shouldInline(*callee, c.args.size())){
+            e->op = OptExpr::Call;
+            return e;
+        }
+
+        // Inline: bind arguments to fresh slots, then run the callee body in this frame.
+        const FnDeclStmt& d = *callee->decl;
+        e->op = OptExpr::Inline;
+        e->type = d.returnType;
+        Scope calleeScope;
+        std::vector<size_t> slots;
+        for (size_t i = 0; i < d.params.size(); ++i){
+            slots.push_back(nextSlot++);
+            e->steps.push_back(OptStep{OptStep::SetLocal, slots[i], TokenType::ERROR, "", std::move(e->kids[i])});
+        }
+        // coerce after every argument is evaluated, matching tier 0's order of errors
+        for (size_t i = 0; i < d.params.size(); ++i){
+            auto arg = eng.newOptExpr();
+            arg->op = OptExpr::Local;
+            arg->slot = slots[i];
+            e->steps.push_back(OptStep{OptStep::SetLocal, slots[i], d.params[i].typeTok,
+                                       "parameter '" + d.params[i].name + "'", std::move(arg), c.loc});
+            calleeScope[d.params[i].name] = slots[i];
+        }
+        e->kids.clear();
+
+        Scope* saved = scope;
+        scope = &calleeScope;
+        inlinedNodes += callee->nodes;
+        inlineStack.push_back(callee);
+        Ptr result = body(d, e->steps, e->loc);   // the result coercion reports the return statement
+        inlineStack.pop_back();
+        scope = saved;
+        if (!result) e->type = TokenType::ERROR;   // no return: plain 0, as in tier 0
+        e->kids.push_back(result ? std::move(result) : constant(0LL));
+        e->name = "return value of '" + d.name + "'";
+        return e;
+    }
+
+    Ptr visitUnknownExpr(const Expr&){ throw RuntimeError("Unknown expression kind"); }
+
+private:
+    Ptr constant(Value v){
+        auto e = eng.newOptExpr();
+        e->op = OptExpr::Const;
+        e->value = std::move(v);
+        return e;
+    }
+
+    // Compiles statements up to the first return into `out`; returns the return
+    // expression and sets `returnLoc` to the return statement's offset.
+    Ptr body(const FnDeclStmt& d, std::vector<OptStep>& out, uint32_t& returnLoc){
+        for (auto& st : d.body->statements){
+            switch (st->kind){
+                case NodeKind::VarDecl: {
+                    auto* v = static_cast<const VarDeclStmt*>(st.get());
+                    Ptr init = visitExpr(*v->init);
+                    size_t slot = nextSlot++;
+                    (*scope)[v->name] = slot;   // visible only after its initializer
+                    out.push_back(OptStep{OptStep::SetLocal, slot, v->typeTok, "variable '" + v->name + "'", std::move(init), v->loc});
+                    break;
+                }
+                case NodeKind::ExprStmt:
+                    out.push_back(OptStep{OptStep::Eval, 0, TokenType::ERROR, "",
+                                          visitExpr(*static_cast<const ExprStmt*>(st.get())->expr)});
+                    break;
+                case NodeKind::ReturnStmt:
+                    returnLoc = st->loc;
+                    return visitExpr(*static_cast<const ReturnStmt*>(st.get())->expr);
+                default:
+                    throw RuntimeError("Unsupported statement in '" + d.name + "'", st->loc);
+            }
+        }
+        return nullptr;
+    }
+
+    bool shouldInline(const Function& callee, size_t argc) const {
+        if (!callee.optimizable || argc != callee.decl->params.size()) return false;
+        if (std::find(inlineStack.begin(), inlineStack.end(), &callee) != inlineStack.end()) return false;
+        size_t budget = eng.opts.maxInlineNodes;
+        auto prior = eng.priorCalls.find(callee.decl->name);
+        if (prior != eng.priorCalls.end()){
+            if (prior->second == 0) return false;                          // cold last time
+            if (prior->second >= eng.opts.hotCallThreshold) budget *= 4;   // hot last time
+        }
+        return callee.nodes <= budget && inlinedNodes + callee.nodes <= eng.opts.maxInlineGrowth;
+    }
+
+    ExecutionEngine& eng;
+    Scope* scope = nullptr;
+    size_t nextSlot = 0;
+    size_t inlinedNodes = 0;
+    std::vector<const Function*> inlineStack;
+};
+
+void ExecutionEngine::optimize(Function& fn){
+    fn.optimized = true;
+    if (!fn.optimizable) return;   // stays in tier 0
+    Compiler(*this).compile(fn);
+}
+
+ExecutionEngine::OptExpr* ExecutionEngine::newOptExpr(){
+    if (optBlocks.empty() || optBlocks.back().size() == kOptBlockNodes){
+        optBlocks.emplace_back();
+        optBlocks.back().reserve(kOptBlockNodes);   // never reallocated: nodes keep their address
+    }
+    return &optBlocks.back().emplace_back();
+}
+
+// Functions the loaded profile saw reach hotCallThreshold would tier up on their
+// first call anyway; compiling them here, hottest first and before the program
+// allocates anything, puts their tier 1 code back to back at the start of
+// optBlocks instead of wherever the heap was when each one got hot.
+void ExecutionEngine::compileHot(){
+    std::vector<std::pair<uint64_t, Function*>> hot;
+    for (auto& fn : functions){
+        auto prior = priorCalls.find(fn->decl->name);
+        if (prior != priorCalls.end() && prior->second >= opts.hotCallThreshold && fn->optimizable)
+            hot.push_back({prior->second, fn.get()});
+    }
+    std::stable_sort(hot.begin(), hot.end(), [](const auto& a, const auto& b){ return a.first > b.first; });
+    for (auto& h : hot){
+        Function& fn = *h.second;
+        try {
+            optimize(fn);
+        } catch (const RuntimeError&) {
+            // leave it to the first call, which raises the error where it always did
+            fn.optimized = false;
+            fn.code.clear();
+        }
+    }
+}
+
+// Recursive fast path. Frames are counted across nested calls, since each call
+// level may add up to kMaxOptimizedDepth of them; once kMaxOptNativeDepth are
+// live the rest of the tree is handed to evalOptStack().
+Value ExecutionEngine::evalOpt(const OptExpr& e, std::vector<Value>& slots){
+    if (optNativeDepth >= kMaxOptNativeDepth) return evalOptStack(e, slots);
+    struct Frame {
+        size_t& n;
+        explicit Frame(size_t& n) : n(n) { ++n; }
+        ~Frame() { --n; }
+    } frame(optNativeDepth);
+
+    switch (e.op){
+        case OptExpr::Const:  return e.value;
+        case OptExpr::Local:  return slots[e.slot];
+        case OptExpr::Global: {
+            auto g = globals.find(e.name);
+            if (g == globals.end()) throw RuntimeError("Undefined variable '" + e.name + "'", e.loc);
+            return g->second;
+        }
+        case OptExpr::Neg:    return negate(evalOpt(*e.kids[0], slots), e.loc);
+        case OptExpr::Binary: {
+            Value l = evalOpt(*e.kids[0], slots);
+            Value r = evalOpt(*e.kids[1], slots);
+            return binary(e.type, l, r, opts.maxStringLength, e.loc);
+        }
+        case OptExpr::Call: {
+            if (!e.fn) throw RuntimeError("Undefined function '" + e.name + "'", e.loc);
+            std::vector<Value> args;
+            args.reserve(e.kids.size());
+            for (auto& k : e.kids) args.push_back(evalOpt(*k, slots));
+            return invoke(*e.fn, std::move(args), e.loc);
+        }
+        case OptExpr::Inline: {
+            Value ignored;
+            execSteps(e.steps, slots, ignored);
+            return coerce(evalOpt(*e.kids[0], slots), e.type, e.name, e.loc);
+        }
+    }
+    throw RuntimeError("Unknown tier 1 operation");
+}
+
+// Same evaluation with explicit task/value stacks, like Tier0, so it costs heap
+// rather than C++ frames; only calls recurse, through invoke(), and those are
+// bounded by maxCallDepth.
+Value ExecutionEngine::evalOptStack(const OptExpr& root, std::vector<Value>& slots){
+    const size_t taskBase = optTasks.size();
+    const size_t valueBase = optValues.size();
+    struct Unwind {   // drop this evaluation's entries if it throws
+        ExecutionEngine& eng; size_t t, v;
+        ~Unwind() { eng.optTasks.resize(t); eng.optValues.resize(v); }
+    } unwind{*this, taskBase, valueBase};
+
+    auto pop = [&]{ Value v = std::move(optValues.back()); optValues.pop_back(); return v; };
+    auto done = [&](Value v){ optValues.push_back(std::move(v)); optTasks.pop_back(); };
+
+    optTasks.push_back({&root, 0});
+    while (optTasks.size() > taskBase){
+        const OptExpr& e = *optTasks.back().e;
+        size_t stage = optTasks.back().stage++;
+        switch (e.op){
+            case OptExpr::Const:  done(e.value); break;
+            case OptExpr::Local:  done(slots[e.slot]); break;
+            case OptExpr::Global: {
+                auto g = globals.find(e.name);
+                if (g == globals.end()) throw RuntimeError("Undefined variable '" + e.name + "'", e.loc);
+                done(g->second);
+                break;
+            }
+            case OptExpr::Neg:
+                if (stage == 0) optTasks.push_back({e.kids[0], 0});
+                else done(negate(pop(), e.loc));
+                break;
+            case OptExpr::Binary:
+                if (stage < 2) { optTasks.push_back({e.kids[stage], 0}); break; }
+                {
+                    Value r = pop();
+                    Value l = pop();
+                    done(binary(e.type, l, r, opts.maxStringLength, e.loc));
+                }
+                break;
+            case OptExpr::Call: {
+                if (stage == 0 && !e.fn) throw RuntimeError("Undefined function '" + e.name + "'", e.loc);
+                if (stage < e.kids.size()) { optTasks.push_back({e.kids[stage], 0}); break; }
+                std::vector<Value> args(std::make_move_iterator(optValues.end() - (std::ptrdiff_t)e.kids.size()),
+                                        std::make_move_iterator(optValues.end()));
+                optValues.resize(optValues.size() - e.kids.size());
+                Value v = invoke(*e.fn, std::move(args), e.loc);   // may grow optTasks: re-read after
+                done(std::move(v));
+                break;
+            }
+            case OptExpr::Inline: {
+                // stages 2i / 2i+1 evaluate and store step i (only SetLocal/Eval
+                // occur here); then the result expression, then its coercion
+                size_t step = stage / 2;
+                if (step < e.steps.size()){
+                    const OptStep& s = e.steps[step];
+                    if (stage % 2 == 0) { optTasks.push_back({s.expr, 0}); break; }
+                    Value v = pop();
+                    if (s.kind == OptStep::SetLocal) slots[s.slot] = coerce(std::move(v), s.type, s.what, s.loc);
+                    break;
+                }
+                if (stage == 2 * e.steps.size()) { optTasks.push_back({e.kids[0], 0}); break; }
+                done(coerce(pop(), e.type, e.name, e.loc));
+                break;
+            }
+            default:
+                throw RuntimeError("Unknown tier 1 operation");
+        }
+    }
+    Value result = pop();
+    return result;
+}
+
+bool ExecutionEngine::execSteps(const std::vector<OptStep>& steps, std::vector<Value>& slots, Value& result){
+    for (auto& s : steps){
+        switch (s.kind){
+            case OptStep::SetLocal: slots[s.slot] = coerce(evalOpt(*s.expr, slots), s.type, s.what, s.loc); break;
+            case OptStep::Eval:     evalOpt(*s.expr, slots); break;
+            case OptStep::Return:   result = coerce(evalOpt(*s.expr, slots), s.type, s.what, s.loc); return true;
+        }
+    }
+    return false;
+}
+
+Value ExecutionEngine::runTier1(Function& fn, std::vector<Value>& args, uint32_t at){
+    const FnDeclStmt& d = *fn.decl;
+    std::vector<Value> slots(fn.frameSize);
+    for (size_t i = 0; i < args.size(); ++i)
+        slots[i] = coerce(std::move(args[i]), d.params[i].typeTok, "parameter '" + d.params[i].name + "'", at);
+    Value result = 0LL;
+    execSteps(fn.code, slots, result);
+    return result;
+}
+
+// ---------- Calls ----------
+Value ExecutionEngine::invoke(Function& fn, std::vector<Value> args, uint32_t at){
+    const FnDeclStmt& d = *fn.decl;
+    if (args.size() != d.params.size())
+        throw RuntimeError("Function '" + d.name + "' expects " + std::to_string(d.params.size())
+                           + " arguments, got " + std::to_string(args.size()), at);
+    if (depth >= opts.maxCallDepth)
+        throw RuntimeError("Call depth exceeded " + std::to_string(opts.maxCallDepth) + " in '" + d.name + "'", at);
+    if (callCount >= opts.maxCalls)
+        throw RuntimeError("Call limit exceeded " + std::to_string(opts.maxCalls) + " in '" + d.name + "'", at);
+
+    ++callCount;
+    ++fn.calls;
+    if (!fn.optimized){
+        auto prior = priorCalls.find(d.name);
+        uint64_t seen = fn.calls + (prior == priorCalls.end() ? 0 : prior->second);
+        if (seen >= opts.hotCallThreshold) optimize(fn);
+    }
+
+    struct DepthGuard {
+        size_t& d;
+        explicit DepthGuard(size_t& x) : d(x) { ++d; }
+        ~DepthGuard() { --d; }
+    } guard(depth);
+    return fn.optimized && fn.optimizable ? runTier1(fn, args, at) : runTier0(fn, args, at);
+}
+
+Value ExecutionEngine::run(const std::string& entry){
+    layout();
+    compileHot();
+    globals.clear();
+    callCount = 0;
+    for (auto& item : program->items){
+        switch (item->kind){
+            case NodeKind::VarDecl: {
+                auto* v = static_cast<const VarDeclStmt*>(item.get());
+                Value init = eval(*v->init, nullptr);
+                globals[v->name] = coerce(std::move(init), v->typeTok, "variable '" + v->name + "'", v->loc);
+                break;
+            }
+            case NodeKind::ExprStmt:
+                eval(*static_cast<const ExprStmt*>(item.get())->expr, nullptr);
+                break;
+            default:
+                break;
+        }
+    }
+    Function* fn = lookup(entry);
+    if (!fn) throw RuntimeError("Undefined function '" + entry + "'");
+    return invoke(*fn, {}, fn->decl->loc);   // no call site: report the declaration
+}
+
+// ---------- Profiles ----------
+std::vector<FunctionProfile> ExecutionEngine::profile() const {
+    std::vector<FunctionProfile> out;
+    // compileHot() may have compiled functions this run never called
+    for (auto& fn : functions) out.push_back({fn->decl->name, fn->calls, fn->optimized && fn->optimizable && fn->calls > 0});
+    std::stable_sort(out.begin(), out.end(), [](const auto& a, const auto& b){ return a.calls > b.calls; });
+    return out;
+}
+
+// Format: a header line, then "<name> <calls> <tier>" per function, hottest first.
+void ExecutionEngine::dumpProfile(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out.is_open()) throw std::runtime_error("Could not open file: " + path);
+    out << "# fn-profile v1\n";
+    for (auto& p : profile()) out << p.name << " " << p.calls << " " << (p.optimized ? 1 : 0) << "\n";
+}
+
+void ExecutionEngine::loadProfile(const std::string& path){
+    std::ifstream in(path);
+    if (!in.is_open()) throw std::runtime_error("Could not open file: " + path);
+    std::string line;
+    if (!std::getline(in, line) || line != "# fn-profile v1")
+        throw std::runtime_error("Not a function profile: " + path);
+    while (std::getline(in, line)){
+        std::istringstream fields(line);
+        std::string name;
+        uint64_t calls = 0;
+        int tier = 0;
+        if (!(fields >> name >> calls >> tier)) throw std::runtime_error("Malformed profile line: " + line);
+        priorCalls[name] = calls;
+    }
+}
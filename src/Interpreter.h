@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+#include "AST.h"
+
+// ---------- Execution engine ----------
+// Runs a parsed Program. Every function starts in tier 0, which walks the AST
+// directly. Once its call count reaches EngineOptions::hotCallThreshold it is
+// compiled to tier 1: locals resolved to frame slots, constant expressions
+// folded and small callees inlined. Call counts can be written to a profile
+// file and fed back into a later run to tier up and inline from the start.
+// Inlined calls are not counted in the callee's profile, the call depth or maxCalls.
+
+using Value = std::variant<long long, double, std::string>;
+std::string valueToString(const Value& v);
+
+struct RuntimeError : std::runtime_error {
+    // source offset (see SourceMap.h) of the expression or statement that failed:
+    // the operator, identifier or call site, or the declaration or return being
+    // coerced; unset for errors that belong to no node, such as a missing entry point
+    std::optional<uint32_t> offset;
+    explicit RuntimeError(const std::string& msg, std::optional<uint32_t> at = std::nullopt)
+        : std::runtime_error(msg), offset(at) {}
+};
+
+struct EngineOptions {
+    uint64_t hotCallThreshold = 1000;   // calls before a function moves to tier 1
+    size_t maxInlineNodes = 24;         // AST nodes a callee may have to be inlined
+    size_t maxInlineGrowth = 256;       // inlined nodes allowed per compiled function
+    size_t maxCallDepth = 1000;         // deeper recursion raises RuntimeError
+    uint64_t maxCalls = UINT64_MAX;     // calls per run() (inlined ones excluded) before RuntimeError
+    size_t maxStringLength = SIZE_MAX;  // longer string '+' results raise RuntimeError
+};
+
+struct FunctionProfile {
+    std::string name;
+    uint64_t calls = 0;                 // this run only
+    bool optimized = false;             // reached tier 1
+};
+
+class ExecutionEngine {
+public:
+    explicit ExecutionEngine(std::shared_ptr<Program> program, EngineOptions opts = EngineOptions());
+    ~ExecutionEngine();
+    ExecutionEngine(const ExecutionEngine&) = delete;
+    ExecutionEngine& operator=(const ExecutionEngine&) = delete;
+
+    // Reads a profile written by dumpProfile(). Call before run(): functions that
+    // were hot are compiled when run() starts, hottest first, so their tier 1 code
+    // is laid out together, and are inlined more eagerly; functions that were
+    // never called are not inlined.
+    void loadProfile(const std::string& path);
+
+    // Evaluates top-level declarations, then calls `entry` with no arguments.
+    Value run(const std::string& entry = "main");
+
+    std::vector<FunctionProfile> profile() const;
+    void dumpProfile(const std::string& path) const;
+
+private:
+    struct Function;
+    struct OptExpr;
+    struct OptStep;
+    struct OptTask { const OptExpr* e; size_t stage; };
+    class Tier0;
+    class Compiler;
+
+    using Env = std::unordered_map<std::string, Value>;
+
+    // Tier 1 compiles expressions recursively; functions nested deeper stay in tier 0.
+    static constexpr size_t kMaxOptimizedDepth = 256;
+    // Recursive evalOpt() frames allowed at once, summed over all active calls.
+    static constexpr size_t kMaxOptNativeDepth = 512;
+
+    // Tier 1 nodes are allocated in compile order from blocks of kOptBlockNodes,
+    // so each compiled function's code is contiguous.
+    static constexpr size_t kOptBlockNodes = 1024;
+
+    void layout();
+    void compileHot();
+    OptExpr* newOptExpr();
+    Function* lookup(const std::string& name) const;
+    Value eval(const Expr& e, const Env* locals);
+    // `at` is the call site, reported by call errors and parameter coercions
+    Value invoke(Function& fn, std::vector<Value> args, uint32_t at);
+    Value runTier0(Function& fn, std::vector<Value>& args, uint32_t at);
+    Value runTier1(Function& fn, std::vector<Value>& args, uint32_t at);
+    Value evalOpt(const OptExpr& e, std::vector<Value>& slots);
+    Value evalOptStack(const OptExpr& root, std::vector<Value>& slots);
+    bool execSteps(const std::vector<OptStep>& steps, std::vector<Value>& slots, Value& result);
+    void optimize(Function& fn);
+
+    std::shared_ptr<Program> program;
+    EngineOptions opts;
+    std::vector<std::unique_ptr<Function>> functions;
+    std::vector<std::vector<OptExpr>> optBlocks;   // all tier 1 nodes; cleared by layout()
+    std::unordered_map<std::string, size_t> byName;
+    std::unordered_map<std::string, uint64_t> priorCalls;   // from loadProfile()
+    Env globals;
+    size_t depth = 0;
+    uint64_t callCount = 0;             // this run()
+    size_t optNativeDepth = 0;
+    // evalOptStack's work stacks; nested calls push above their caller's entries
+    std::vector<OptTask> optTasks;
+    std::vector<Value> optValues;
+};
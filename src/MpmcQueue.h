@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// Bounded lock-free multi-producer / multi-consumer queue (Vyukov's design).
+// Every slot carries a sequence number that tells producers and consumers whose
+// turn it is, so push/pop are one CAS on the shared index plus one release store.
+template <typename T>
+class MpmcQueue {
+public:
+    // capacity is rounded up to a power of two
+    explicit MpmcQueue(size_t capacity) : mask(roundUp(capacity) - 1), slots(new Slot[mask + 1]) {
+        for (size_t i = 0; i <= mask; ++i) slots[i].seq.store(i, std::memory_order_relaxed);
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    // Returns false (and leaves `value` untouched) when the queue is full.
+    bool tryPush(T& value) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& s = slots[pos & mask];
+            size_t seq = s.seq.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    s.value = std::move(value);
+                    s.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Returns false when the queue is empty.
+    bool tryPop(T& out) {
+        size_t pos = head.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& s = slots[pos & mask];
+            size_t seq = s.seq.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)(pos + 1);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(s.value);
+                    s.seq.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    static constexpr size_t kCacheLine = 64;
+
+    struct Slot {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    static size_t roundUp(size_t n) {
+        if (n < 2) return 2;
+        size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    const size_t mask;
+    std::unique_ptr<Slot[]> slots;
+    alignas(kCacheLine) std::atomic<size_t> head;   // consumers
+    alignas(kCacheLine) std::atomic<size_t> tail;   // producers
+};
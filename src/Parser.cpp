@@ -1,21 +1,73 @@
 #include "Parser.h"
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <utility>
 
-Parser::Parser(const std::vector<Token>& toks) : tokens(toks), pos(0) {}
+Parser::Parser(const std::vector<Token>& toks)
+    : ownedBuf(std::make_unique<TokenBuffer>()), buf(*ownedBuf), pos(0), end(0),
+      maxNestingDepth(kDefaultMaxNestingDepth) {
+    ownedBuf->assign(toks);
+    end = buf.size();
+}
+
+Parser::Parser(const TokenBuffer& toks) : Parser(toks, 0, toks.size()) {}
+
+Parser::Parser(const TokenBuffer& toks, size_t first, size_t last)
+    : buf(toks), pos(first), end(last), maxNestingDepth(kDefaultMaxNestingDepth) {}
+
+namespace {
+// make_shared plus the node's source location.
+template <typename T, typename... Args>
+std::shared_ptr<T> makeNode(uint32_t loc, Args&&... args){
+    auto n = std::make_shared<T>(std::forward<Args>(args)...);
+    n->loc = loc;
+    return n;
+}
+
+// The canonical copy of `e` when hash-consing, `e` itself otherwise.
+ExprPtr share(ExprInterner* interner, ExprPtr e){
+    return interner ? interner->intern(std::move(e)) : e;
+}
+} // namespace
+
+void Parser::setHashConsing(bool enabled){
+    if (!enabled && interner){
+        InternStats last = interner->stats();
+        last.tableBytes = 0;   // freed below (parallel workers have already dropped their references)
+        freedInternStats += last;
+        interner.reset();
+    }
+    else if (enabled && !interner) interner = std::make_shared<ExprInterner>();
+}
+
+InternStats Parser::hashConsStats() const {
+    InternStats total = freedInternStats;
+    if (interner) total += interner->stats();
+    return total;
+}
+
+std::optional<uint32_t> Parser::endLocation() const {
+    if (end == 0) return std::nullopt;
+    return location(buf.tokens[end - 1]);
+}
 
-const Token& Parser::peek() const { 
-    if (pos >= tokens.size()) throw ParseException(ParseErrorKind::UnexpectedEOF,"Unexpected EOF");
-    return tokens[pos]; 
+const PackedToken& Parser::peek() const { 
+    if (pos >= end) throw ParseException(ParseErrorKind::UnexpectedEOF,"Unexpected EOF", std::nullopt, endLocation());
+    return buf.tokens[pos]; 
 }
-const Token& Parser::previous() const { 
+const PackedToken& Parser::previous() const { 
     if (pos==0) throw ParseException(ParseErrorKind::UnexpectedEOF,"No previous token");
-    return tokens[pos-1]; 
+    return buf.tokens[pos-1]; 
 }
-bool Parser::isAtEnd() const { return pos >= tokens.size(); }
-bool Parser::check(TokenType t) const { return !isAtEnd() && tokens[pos].type == t; }
-const Token& Parser::advance() { 
+bool Parser::isAtEnd() const { return pos >= end; }
+bool Parser::check(TokenType t) const { return !isAtEnd() && buf.type(pos) == t; }
+const PackedToken& Parser::advance() { 
     if (!isAtEnd()) ++pos; 
-    return tokens[pos-1];
+    return buf.tokens[pos-1];
 }
 bool Parser::match(std::initializer_list<TokenType> types){
     for (auto t: types){
@@ -23,19 +75,113 @@ bool Parser::match(std::initializer_list<TokenType> types){
     }
     return false;
 }
-const Token& Parser::consume(TokenType t, const char* msg){
+const PackedToken& Parser::consume(TokenType t, const char* msg){
     if (check(t)) return advance();
-    throw ParseException(ParseErrorKind::UnexpectedToken, std::string(msg) + " Found: " + tokens[pos].value, tokens[pos]);
+    if (isAtEnd()) throw ParseException(ParseErrorKind::UnexpectedEOF, std::string(msg) + " Found: end of input", std::nullopt, endLocation());
+    throw ParseException(ParseErrorKind::UnexpectedToken, std::string(msg) + " Found: " + text(buf.tokens[pos]), buf.token(buf.tokens[pos]));
 }
 
 // program := (fnDecl | varDecl)* EOF
 std::shared_ptr<Program> Parser::parseProgram(){
     auto prog = std::make_shared<Program>();
+    parseItems(prog->items);
+    return prog;
+}
+
+void Parser::parseItems(std::vector<StmtPtr>& items){
     while (!isAtEnd()){
         // tolerate stray ERROR tokens from lexer
-        if (check(TokenType::ERROR)) throw ParseException(ParseErrorKind::UnexpectedToken, "Lexer error token encountered", peek());
-        prog->items.push_back(declaration());
+        if (check(TokenType::ERROR)) throw ParseException(ParseErrorKind::UnexpectedToken, "Lexer error token encountered", buf.token(peek()));
+        items.push_back(declaration());
+    }
+}
+
+// Cuts the remaining tokens into [begin, end) ranges that each hold either one
+// top-level `fn ... { ... }` (closed by the brace that returns to depth 0) or a
+// run of other top-level declarations. Malformed input still yields ranges; it
+// just fails to parse and triggers the sequential fallback.
+std::vector<std::pair<size_t, size_t>> Parser::splitTopLevel() const {
+    std::vector<std::pair<size_t, size_t>> segments;
+    size_t segStart = pos;
+    size_t depth = 0;
+    bool inFn = false;
+    for (size_t i = pos; i < end; ++i){
+        switch (buf.type(i)){
+            case TokenType::FUNCTION:
+                if (depth == 0){
+                    if (i > segStart) segments.emplace_back(segStart, i);
+                    segStart = i;
+                    inFn = true;
+                }
+                break;
+            case TokenType::BRACEL:
+                ++depth;
+                break;
+            case TokenType::BRACER:
+                if (depth > 0 && --depth == 0 && inFn){
+                    segments.emplace_back(segStart, i + 1);
+                    segStart = i + 1;
+                    inFn = false;
+                }
+                break;
+            default:
+                break;
+        }
     }
+    if (segStart < end) segments.emplace_back(segStart, end);
+    return segments;
+}
+
+std::shared_ptr<Program> Parser::parseProgramParallel(unsigned threads, size_t minTokensPerThread){
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t count = end - pos;
+    threads = (unsigned)std::min<size_t>(threads, count / std::max<size_t>(minTokensPerThread, 1));
+    if (threads <= 1) return parseProgram();
+
+    auto segments = splitTopLevel();
+    if (segments.size() < 2) return parseProgram();
+
+    // Hand each worker a contiguous run of segments holding ~count/threads tokens.
+    std::vector<size_t> firstSeg{0};
+    size_t perThread = count / threads, acc = 0;
+    for (size_t s = 0; s < segments.size(); ++s){
+        acc += segments[s].second - segments[s].first;
+        if (acc >= perThread * firstSeg.size() && firstSeg.size() < threads && s + 1 < segments.size())
+            firstSeg.push_back(s + 1);
+    }
+    firstSeg.push_back(segments.size());
+
+    std::vector<std::vector<StmtPtr>> parsed(segments.size());
+    std::atomic<bool> failed{false};
+    auto work = [&](size_t from, size_t to){
+        try {
+            for (size_t s = from; s < to && !failed.load(std::memory_order_relaxed); ++s){
+                Parser sub(buf, segments[s].first, segments[s].second);
+                sub.maxNestingDepth = maxNestingDepth;
+                sub.interner = interner;
+                sub.parseItems(parsed[s]);
+            }
+        } catch (...) {
+            failed.store(true, std::memory_order_relaxed);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t + 1 < firstSeg.size(); ++t)
+        pool.emplace_back(work, firstSeg[t], firstSeg[t + 1]);
+    work(firstSeg[0], firstSeg[1]);
+    for (auto& th : pool) th.join();
+
+    // Let the sequential parser produce the diagnostic.
+    if (failed.load()) return parseProgram();
+
+    auto prog = std::make_shared<Program>();
+    size_t total = 0;
+    for (auto& items : parsed) total += items.size();
+    prog->items.reserve(total);
+    for (auto& items : parsed)
+        for (auto& it : items) prog->items.push_back(std::move(it));
+    pos = end;
     return prog;
 }
 
@@ -44,9 +190,9 @@ StmtPtr Parser::declaration(){
         return fnDeclaration();
     }
     // allow top-level variable declarations: type ident = expr ;
-    if (!isAtEnd() && isTypeToken(peek().type)) {
-        Token typeTok = advance();
-        return varDeclaration(typeTok.type);
+    if (!isAtEnd() && isTypeToken(peek().type())) {
+        TokenType typeTok = advance().type();
+        return varDeclaration(typeTok);
     }
     // Otherwise try an expression statement to avoid deadlock
     return exprStatement();
@@ -54,12 +200,13 @@ StmtPtr Parser::declaration(){
 
 // fnDecl := "fn" [type]? IDENT "(" paramList? ")" "{" block "}"
 StmtPtr Parser::fnDeclaration(){
+    uint32_t loc = location(previous());   // the 'fn'
     // optional return type
     TokenType returnType = TokenType::ERROR; // "unspecified"
-    if (isTypeToken(peek().type)){
-        returnType = advance().type;
+    if (isTypeToken(peek().type())){
+        returnType = advance().type();
     }
-    const Token& nameTok = consume(TokenType::IDENTIFIER, "Expected function name after 'fn' (or return type).");
+    const PackedToken& nameTok = consume(TokenType::IDENTIFIER, "Expected function name after 'fn' (or return type).");
 
     consume(TokenType::PARENL, "Expected '(' after function name.");
     std::vector<Param> params;
@@ -71,7 +218,7 @@ StmtPtr Parser::fnDeclaration(){
     auto bodyBlock = block();
     consume(TokenType::BRACER, "Expected '}' to close function body.");
 
-    return std::make_shared<FnDeclStmt>(returnType, nameTok.value, std::move(params), bodyBlock);
+    return makeNode<FnDeclStmt>(loc, returnType, text(nameTok), std::move(params), bodyBlock);
 }
 
 // paramList := type IDENT ("," type IDENT)*
@@ -79,17 +226,17 @@ std::vector<Param> Parser::parameterList(){
     std::vector<Param> ps;
     
     // Handle empty parameter list
-    if (!isTypeToken(peek().type)) {
+    if (!isTypeToken(peek().type())) {
         return ps;
     }
     
     // Parse parameters
     while (true){
-        if (!isTypeToken(peek().type))
-            throw ParseException(ParseErrorKind::ExpectedTypeToken, "Expected parameter type.", peek());
-        TokenType pt = advance().type;
-        const Token& pn = consume(TokenType::IDENTIFIER, "Expected parameter name.");
-        ps.push_back(Param{pt, pn.value});
+        if (!isTypeToken(peek().type()))
+            throw ParseException(ParseErrorKind::ExpectedTypeToken, "Expected parameter type.", buf.token(peek()));
+        TokenType pt = advance().type();
+        const PackedToken& pn = consume(TokenType::IDENTIFIER, "Expected parameter name.");
+        ps.push_back(Param{pt, text(pn)});
         if (!match({TokenType::COMMA})) break;
     }
     return ps;
@@ -97,7 +244,7 @@ std::vector<Param> Parser::parameterList(){
 
 // block := { statement* }   (caller has already consumed '{')
 std::shared_ptr<BlockStmt> Parser::block(){
-    auto blk = std::make_shared<BlockStmt>();
+    auto blk = makeNode<BlockStmt>(location(previous()));
     while (!isAtEnd() && !check(TokenType::BRACER)){
         blk->statements.push_back(statement());
     }
@@ -105,9 +252,9 @@ std::shared_ptr<BlockStmt> Parser::block(){
 }
 
 StmtPtr Parser::statement(){
-    if (isTypeToken(peek().type)) {
-        Token t = advance();
-        return varDeclaration(t.type);
+    if (isTypeToken(peek().type())) {
+        TokenType t = advance().type();
+        return varDeclaration(t);
     }
     if (match({TokenType::RETURN})) return returnStatement();
     return exprStatement();
@@ -115,121 +262,202 @@ StmtPtr Parser::statement(){
 
 // varDecl := type IDENT "=" expression ";"
 StmtPtr Parser::varDeclaration(TokenType typeTok){
-    const Token& nameTok = consume(TokenType::IDENTIFIER, "Expected variable name.");
+    uint32_t loc = location(previous());   // the type keyword
+    const PackedToken& nameTok = consume(TokenType::IDENTIFIER, "Expected variable name.");
     consume(TokenType::ASSIGNOP, "Expected '=' in variable declaration.");
     ExprPtr initExpr = expression();
     consume(TokenType::SEMICOLON, "Expected ';' after variable declaration.");
-    return std::make_shared<VarDeclStmt>(typeTok, nameTok.value, initExpr);
+    return makeNode<VarDeclStmt>(loc, typeTok, text(nameTok), initExpr);
 }
 
 // returnStmt := "return" expression ";"
 StmtPtr Parser::returnStatement(){
+    uint32_t loc = location(previous());
     ExprPtr e = expression();
     consume(TokenType::SEMICOLON, "Expected ';' after return value.");
-    return std::make_shared<ReturnStmt>(e);
+    return makeNode<ReturnStmt>(loc, e);
 }
 
 // exprStmt := expression ";"
 StmtPtr Parser::exprStatement(){
+    size_t first = pos;
     ExprPtr e = expression();
     consume(TokenType::SEMICOLON, "Expected ';' after expression.");
-    return std::make_shared<ExprStmt>(e);
+    return makeNode<ExprStmt>(location(buf.tokens[first]), e);
 }
 
 // ---------- Expressions ----------
-ExprPtr Parser::expression(){ return equality(); }
+// Grammar (lowest to highest precedence):
+//   expression     := equality
+//   equality       := addition ( "==" addition )*
+//   addition       := multiplication ( ("+"|"-") multiplication )*
+//   multiplication := unary ( ("*"|"/") unary )*
+//   unary          := "-" unary | call
+//   call           := primary ("(" argList? ")")*
+//   primary        := INTLIT | FLOATLIT | STRINGLIT | IDENT | "(" expression ")"
+// Pending operators live on an explicit frame stack instead of the C++ call stack,
+// so input like ((((...)))) or - - - x only costs heap, bounded by maxNestingDepth.
 
-// equality := addition ( "==" addition )*
-ExprPtr Parser::equality(){
-    ExprPtr expr = addition();
-    while (match({TokenType::EQUALSOP})){
-        TokenType op = previous().type;
-        ExprPtr right = addition();
-        expr = std::make_shared<BinaryExpr>(op, expr, right);
-    }
-    return expr;
-}
+namespace {
 
-// addition := multiplication ( ("+"|"-") multiplication )*
-ExprPtr Parser::addition(){
-    ExprPtr expr = multiplication();
-    while (match({TokenType::ADDOP, TokenType::SUBOP})){
-        TokenType op = previous().type;
-        ExprPtr right = multiplication();
-        expr = std::make_shared<BinaryExpr>(op, expr, right);
+struct ExprFrame {
+    enum Kind { Binary, Unary, Group, Call } kind;
+    TokenType op;           // Binary / Unary
+    std::string callee;     // Call
+    size_t argBase;         // Call: index of the first argument on the operand stack
+    uint32_t loc;           // operator token, or the callee name
+};
+
+int binaryPrecedence(TokenType t){
+    switch (t){
+        case TokenType::EQUALSOP: return 1;
+        case TokenType::ADDOP:
+        case TokenType::SUBOP:    return 2;
+        case TokenType::MULOP:
+        case TokenType::DIVOP:    return 3;
+        default:                  return 0;
     }
-    return expr;
 }
 
-// multiplication := unary ( ("*"|"/") unary )*
-ExprPtr Parser::multiplication(){
-    ExprPtr expr = unary();
-    while (match({TokenType::MULOP, TokenType::DIVOP})){
-        TokenType op = previous().type;
-        ExprPtr right = unary();
-        expr = std::make_shared<BinaryExpr>(op, expr, right);
+// Folds the top Binary/Unary/Call frame into a single operand.
+void reduce(std::vector<ExprFrame>& frames, std::vector<ExprPtr>& operands, ExprInterner* interner){
+    ExprFrame f = std::move(frames.back());
+    frames.pop_back();
+    switch (f.kind){
+        case ExprFrame::Binary: {
+            ExprPtr right = std::move(operands.back()); operands.pop_back();
+            ExprPtr left = std::move(operands.back()); operands.pop_back();
+            operands.push_back(share(interner, makeNode<BinaryExpr>(f.loc, f.op, std::move(left), std::move(right))));
+            break;
+        }
+        case ExprFrame::Unary: {
+            ExprPtr e = std::move(operands.back()); operands.pop_back();
+            operands.push_back(share(interner, makeNode<UnaryExpr>(f.loc, f.op, std::move(e))));
+            break;
+        }
+        case ExprFrame::Call: {
+            std::vector<ExprPtr> args(std::make_move_iterator(operands.begin() + f.argBase),
+                                      std::make_move_iterator(operands.end()));
+            operands.resize(f.argBase);
+            operands.push_back(share(interner, makeNode<CallExpr>(f.loc, std::move(f.callee), std::move(args))));
+            break;
+        }
+        case ExprFrame::Group:
+            break;
     }
-    return expr;
 }
 
-// unary := ("-" ) unary | call
-ExprPtr Parser::unary(){
-    if (match({TokenType::SUBOP})){
-        TokenType op = previous().type;
-        return std::make_shared<UnaryExpr>(op, unary());
-    }
-    return call();
+// Reduces pending operators down to the innermost open '(' or call.
+void reduceToOpen(std::vector<ExprFrame>& frames, std::vector<ExprPtr>& operands, ExprInterner* interner){
+    while (!frames.empty() && (frames.back().kind == ExprFrame::Binary || frames.back().kind == ExprFrame::Unary))
+        reduce(frames, operands, interner);
 }
 
-// call := primary ("(" argList? ")")*
-ExprPtr Parser::call(){
-    ExprPtr expr = primary();
+} // namespace
+
+ExprPtr Parser::expression(){
+    std::vector<ExprFrame> frames;
+    std::vector<ExprPtr> operands;
+    size_t openParens = 0;  // Group + Call frames on the stack
+    uint32_t primaryLoc = 0;  // token of the last primary (a callee, if '(' follows)
+
+    auto push = [&](ExprFrame f){
+        if (frames.size() >= maxNestingDepth)
+            throw ParseException(ParseErrorKind::NestingTooDeep,
+                "Expression nesting exceeds the maximum depth of " + std::to_string(maxNestingDepth) + ".", buf.token(previous()));
+        frames.push_back(std::move(f));
+    };
+
     while (true){
+        // operand position: prefix '-' and '(' open frames, anything else must be a primary
+        if (match({TokenType::SUBOP})){
+            push({ExprFrame::Unary, TokenType::SUBOP, {}, 0, location(previous())});
+            continue;
+        }
         if (match({TokenType::PARENL})){
-            expr = finishCall(expr);
-        } else {
-            break;
+            push({ExprFrame::Group, TokenType::ERROR, {}, 0, location(previous())});
+            ++openParens;
+            continue;
         }
-    }
-    return expr;
-}
+        ExprPtr operand = primary();
+        if (!operand) throw ParseException(ParseErrorKind::ExpectedExpr, "Expected expression.", buf.token(peek()));
+        primaryLoc = location(previous());
+        operands.push_back(std::move(operand));
 
-ExprPtr Parser::finishCall(ExprPtr callee){
-    // Only identifiers can be called
-    auto* id = dynamic_cast<IdentExpr*>(callee.get());
-    if (!id)
-        throw ParseException(ParseErrorKind::UnexpectedToken, "Can only call identifiers (e.g., foo(...)).", peek());
+        // operator position: calls, ')' and ',' of open frames, binary operators
+        bool needOperand = false;
+        while (!needOperand){
+            if (match({TokenType::PARENL})){
+                // Only identifiers can be called
+                if (operands.back()->kind != NodeKind::Identifier)
+                    throw ParseException(ParseErrorKind::UnexpectedToken, "Can only call identifiers (e.g., foo(...)).", buf.token(peek()));
+                // An Identifier on top is the last primary. Take its position from the
+                // token: with hash-consing the node is shared and another thread may
+                // be lowering its loc.
+                std::string callee = static_cast<IdentExpr*>(operands.back().get())->name;
+                operands.pop_back();
+                push({ExprFrame::Call, TokenType::ERROR, std::move(callee), operands.size(), primaryLoc});
+                ++openParens;
+                if (match({TokenType::PARENR})){
+                    reduce(frames, operands, interner.get());
+                    --openParens;
+                } else {
+                    needOperand = true;
+                }
+                continue;
+            }
+            int prec = isAtEnd() ? 0 : binaryPrecedence(peek().type());
+            if (prec > 0){
+                while (!frames.empty() &&
+                       (frames.back().kind == ExprFrame::Unary ||
+                        (frames.back().kind == ExprFrame::Binary && binaryPrecedence(frames.back().op) >= prec)))
+                    reduce(frames, operands, interner.get());
+                const PackedToken& opTok = advance();
+                push({ExprFrame::Binary, opTok.type(), {}, 0, location(opTok)});
+                needOperand = true;
+                continue;
+            }
+            if (openParens == 0) break;
 
-    std::vector<ExprPtr> args;
-    if (!check(TokenType::PARENR)){
-        do {
-            args.push_back(expression());
-        } while (match({TokenType::COMMA}));
+            // anything else closes (or fails to close) the innermost '(' or call
+            reduceToOpen(frames, operands, interner.get());
+            bool inCall = frames.back().kind == ExprFrame::Call;
+            if (inCall && match({TokenType::COMMA})){
+                needOperand = true;
+                continue;
+            }
+            consume(TokenType::PARENR, inCall ? "Expected ')' after arguments." : "Expected ')' after expression.");
+            if (inCall) reduce(frames, operands, interner.get());
+            else frames.pop_back();
+            --openParens;
+        }
+        if (!needOperand) break;
     }
-    consume(TokenType::PARENR, "Expected ')' after arguments.");
-    return std::make_shared<CallExpr>(id->name, std::move(args));
+
+    while (!frames.empty()) reduce(frames, operands, interner.get());
+    return std::move(operands.back());
 }
 
-// primary := INTLIT | FLOATLIT | STRINGLIT | IDENT | "(" expression ")"
+// primary := INTLIT | FLOATLIT | STRINGLIT | IDENT   ("(" expression ")" is handled by expression())
 ExprPtr Parser::primary(){
+    // literal values were converted by the lexer; read them from the side tables
     if (match({TokenType::INTLIT})){
-        long long v = std::stoll(previous().value);
-        return std::make_shared<IntLitExpr>(v);
+        const PackedToken& t = previous();
+        if (t.payload == PackedToken::kBadLiteral)
+            throw ParseException(ParseErrorKind::ExpectedIntLit, "Integer literal out of range: " + text(t), buf.token(t));
+        return share(interner.get(), makeNode<IntLitExpr>(location(t), buf.ints[buf.literal(t)]));
     }
     if (match({TokenType::FLOATLIT})){
-        double v = std::stod(previous().value);
-        return std::make_shared<FloatLitExpr>(v);
+        const PackedToken& t = previous();
+        if (t.payload == PackedToken::kBadLiteral)
+            throw ParseException(ParseErrorKind::ExpectedFloatLit, "Float literal out of range: " + text(t), buf.token(t));
+        return share(interner.get(), makeNode<FloatLitExpr>(location(t), buf.floats[buf.literal(t)]));
     }
     if (match({TokenType::STRINGLIT})){
-        return std::make_shared<StringLitExpr>(previous().value);
+        return share(interner.get(), makeNode<StringLitExpr>(location(previous()), text(previous())));
     }
     if (match({TokenType::IDENTIFIER})){
-        return std::make_shared<IdentExpr>(previous().value);
-    }
-    if (match({TokenType::PARENL})){
-        ExprPtr e = expression();
-        consume(TokenType::PARENR, "Expected ')' after expression.");
-        return e;
+        return share(interner.get(), makeNode<IdentExpr>(location(previous()), text(previous())));
     }
-    throw ParseException(ParseErrorKind::ExpectedExpr, "Expected expression.", peek());
+    return nullptr;
 }
@@ -5,6 +5,7 @@
 #include <optional>
 #include "lexer.h"
 #include "AST.h"
+#include "ExprInterner.h"
 
 enum class ParseErrorKind {
     UnexpectedEOF,
@@ -15,35 +16,78 @@ enum class ParseErrorKind {
     ExpectedFloatLit,
     ExpectedIntLit,
     ExpectedStringLit,
-    ExpectedExpr
+    ExpectedExpr,
+    NestingTooDeep
 };
 
 struct ParseException : std::runtime_error {
     ParseErrorKind kind;
     std::optional<Token> token;
-    ParseException(ParseErrorKind k, const std::string& msg, std::optional<Token> t = std::nullopt)
-        : std::runtime_error(msg), kind(k), token(std::move(t)) {}
+    std::optional<uint32_t> offset;   // source offset: the token's, or the last token's at end of input
+    ParseException(ParseErrorKind k, const std::string& msg, std::optional<Token> t = std::nullopt,
+                   std::optional<uint32_t> at = std::nullopt)
+        : std::runtime_error(msg), kind(k), token(std::move(t)),
+          offset(at ? at : token ? std::optional<uint32_t>(token->offset) : std::nullopt) {}
 };
 
 class Parser {
 public:
+    static constexpr size_t kDefaultMaxNestingDepth = 10000;
+
+    // Packs `toks` into a private TokenBuffer first.
     explicit Parser(const std::vector<Token>& toks);
+    // Parses straight from a packed buffer; `toks` must outlive the parser.
+    explicit Parser(const TokenBuffer& toks);
     std::shared_ptr<Program> parseProgram();
 
+    // Same result as parseProgram(), but top-level `fn` declarations are found by
+    // brace matching and parsed on `threads` workers (0 = hardware concurrency),
+    // each getting at least `minTokensPerThread` tokens.
+    // Falls back to a sequential parse when the input is small or malformed, so
+    // errors are reported exactly as parseProgram() would report them.
+    static constexpr size_t kMinTokensPerThread = 4096;
+    std::shared_ptr<Program> parseProgramParallel(unsigned threads = 0, size_t minTokensPerThread = kMinTokensPerThread);
+
+    // Upper bound on pending operators ('(', calls, unary '-', binary ops) inside one
+    // expression. Exceeding it raises ParseErrorKind::NestingTooDeep.
+    void setMaxNestingDepth(size_t depth) { maxNestingDepth = depth; }
+
+    // Builds expressions as a DAG: structurally identical subexpressions become
+    // one shared node (see ExprInterner.h), across the whole program and across
+    // parseProgramParallel()'s workers. Off by default.
+    // setHashConsing(false) after parsing frees the table, and with it the
+    // table's references to every unique node; ASTs already built stay shared.
+    void setHashConsing(bool enabled);
+    // Totals over every parse since hash-consing was first enabled, including
+    // tables already freed; tableBytes covers only the current table.
+    InternStats hashConsStats() const;
+
 private:
-    const std::vector<Token>& tokens;
+    Parser(const TokenBuffer& toks, size_t first, size_t last);   // parses tokens [first, last)
+
+    std::unique_ptr<TokenBuffer> ownedBuf;   // only set by the std::vector<Token> constructor
+    const TokenBuffer& buf;
     size_t pos;
+    size_t end;
+    size_t maxNestingDepth;
+    std::shared_ptr<ExprInterner> interner;   // null unless hash-consing
+    InternStats freedInternStats;             // counts from tables setHashConsing(false) released
 
     // utilities
-    const Token& peek() const;
-    const Token& previous() const;
+    const PackedToken& peek() const;
+    const PackedToken& previous() const;
     bool isAtEnd() const;
     bool check(TokenType t) const;
-    const Token& advance();
+    const PackedToken& advance();
     bool match(std::initializer_list<TokenType> types);
-    const Token& consume(TokenType t, const char* msg);
+    const PackedToken& consume(TokenType t, const char* msg);
+    std::string text(const PackedToken& t) const { return std::string(buf.text(t)); }
+    uint32_t location(const PackedToken& t) const { return buf.location(t); }
+    std::optional<uint32_t> endLocation() const;   // for errors at end of input
 
     // top-level
+    void parseItems(std::vector<StmtPtr>& items);
+    std::vector<std::pair<size_t, size_t>> splitTopLevel() const;
     StmtPtr declaration();
 
     // statements
@@ -55,15 +99,9 @@ private:
     StmtPtr returnStatement();
     StmtPtr exprStatement();
 
-    // expressions (Pratt / precedence climbing)
-    ExprPtr expression();            // -> equality
-    ExprPtr equality();              // == 
-    ExprPtr addition();              // + -
-    ExprPtr multiplication();        // * /
-    ExprPtr unary();                 // (-)x
-    ExprPtr call();                  // primary ( ... )*
-    ExprPtr finishCall(ExprPtr callee);
-    ExprPtr primary();               // identifiers, literals, ( )
+    // expressions (precedence climbing on an explicit stack, no recursion)
+    ExprPtr expression();            // equality / addition / multiplication / unary / call
+    ExprPtr primary();               // identifiers, literals; nullptr if neither
 
     // helpers
     bool isTypeToken(TokenType t) const {
@@ -0,0 +1,57 @@
+#include "SourceMap.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+SourceMap::SourceMap(std::string name, std::string_view text) : fileName(std::move(name)), text(text) {
+    if (text.size() > UINT32_MAX) throw std::length_error("Input too large for 32-bit source offsets");
+}
+
+// Finds every '\n'. With SSE2, 16 bytes are compared per step and the set bits
+// of the match mask are the newline positions; blocks without one cost a single
+// compare. The tail (and non-SSE2 targets) use memchr.
+void SourceMap::buildLineStarts() const {
+    const char* s = text.data();
+    const size_t n = text.size();
+    lineStarts.reserve(n / 32 + 1);
+    lineStarts.push_back(0);
+
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; i + 16 <= n; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+        while (mask) {
+            lineStarts.push_back((uint32_t)(i + __builtin_ctz(mask) + 1));
+            mask &= mask - 1;
+        }
+    }
+#endif
+    while (i < n) {
+        const void* hit = std::memchr(s + i, '\n', n - i);
+        if (!hit) break;
+        i = (size_t)(static_cast<const char*>(hit) - s) + 1;
+        lineStarts.push_back((uint32_t)i);
+    }
+}
+
+SourcePosition SourceMap::position(uint32_t offset) const {
+    std::call_once(built, [this] { buildLineStarts(); });
+    offset = std::min<uint32_t>(offset, (uint32_t)text.size());
+    auto line = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset) - 1;
+    return SourcePosition{(uint32_t)(line - lineStarts.begin()) + 1, offset - *line + 1};
+}
+
+std::string SourceMap::format(uint32_t offset) const {
+    SourcePosition p = position(offset);
+    return fileName + ":" + std::to_string(p.line) + ":" + std::to_string(p.column);
+}
+
+size_t SourceMap::lineCount() const {
+    std::call_once(built, [this] { buildLineStarts(); });
+    return lineStarts.size();
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// ---------- Source locations ----------
+// Tokens and AST nodes record a 32-bit byte offset into their source; a
+// SourceMap turns one into a 1-based line and column. The line-start table is
+// built the first time a position is asked for, so lexing and parsing never
+// pay for it, and each lookup is a binary search over it.
+
+struct SourcePosition {
+    uint32_t line;
+    uint32_t column;    // bytes from the start of the line, 1-based
+};
+
+class SourceMap {
+public:
+    // `text` must outlive the map.
+    SourceMap(std::string name, std::string_view text);
+
+    const std::string& name() const { return fileName; }
+    // Offsets past the end map to the end of the last line.
+    SourcePosition position(uint32_t offset) const;
+    // "name:line:col"
+    std::string format(uint32_t offset) const;
+    size_t lineCount() const;
+
+private:
+    void buildLineStarts() const;
+
+    std::string fileName;
+    std::string_view text;
+    mutable std::once_flag built;
+    mutable std::vector<uint32_t> lineStarts;   // offset of the first byte of each line
+};
@@ -0,0 +1,55 @@
+#pragma once
+#include <utility>
+#include "AST.h"
+
+// ---------- Compile-time visitors ----------
+// CRTP bases: the `kind` switch lives here once, and every case calls the
+// derived class's visitX directly, so dispatch is static and inlinable (no
+// vtables on the nodes). A pass derives from one or both bases and defines the
+// visitX it needs; extra arguments to visitExpr/visitStmt are forwarded.
+//
+//   struct Counter : ExprVisitor<Counter, int> {
+//       int visitBinary(const BinaryExpr& b) { return 1 + visitExpr(*b.left) + visitExpr(*b.right); }
+//       ...
+//   };
+
+template <typename Derived, typename R = void>
+struct ExprVisitor {
+    template <typename... Args>
+    R visitExpr(const Expr& e, Args&&... args) {
+        Derived& d = static_cast<Derived&>(*this);
+        switch (e.kind) {
+            case NodeKind::Binary:     return d.visitBinary(static_cast<const BinaryExpr&>(e), std::forward<Args>(args)...);
+            case NodeKind::Unary:      return d.visitUnary(static_cast<const UnaryExpr&>(e), std::forward<Args>(args)...);
+            case NodeKind::Identifier: return d.visitIdentifier(static_cast<const IdentExpr&>(e), std::forward<Args>(args)...);
+            case NodeKind::IntLit:     return d.visitIntLit(static_cast<const IntLitExpr&>(e), std::forward<Args>(args)...);
+            case NodeKind::FloatLit:   return d.visitFloatLit(static_cast<const FloatLitExpr&>(e), std::forward<Args>(args)...);
+            case NodeKind::StringLit:  return d.visitStringLit(static_cast<const StringLitExpr&>(e), std::forward<Args>(args)...);
+            case NodeKind::Call:       return d.visitCall(static_cast<const CallExpr&>(e), std::forward<Args>(args)...);
+            default:                   return d.visitUnknownExpr(e, std::forward<Args>(args)...);
+        }
+    }
+
+    template <typename... Args>
+    R visitUnknownExpr(const Expr&, Args&&...) { return R(); }
+};
+
+template <typename Derived, typename R = void>
+struct StmtVisitor {
+    template <typename... Args>
+    R visitStmt(const Stmt& s, Args&&... args) {
+        Derived& d = static_cast<Derived&>(*this);
+        switch (s.kind) {
+            case NodeKind::VarDecl:    return d.visitVarDecl(static_cast<const VarDeclStmt&>(s), std::forward<Args>(args)...);
+            case NodeKind::ReturnStmt: return d.visitReturn(static_cast<const ReturnStmt&>(s), std::forward<Args>(args)...);
+            case NodeKind::ExprStmt:   return d.visitExprStmt(static_cast<const ExprStmt&>(s), std::forward<Args>(args)...);
+            case NodeKind::Block:      return d.visitBlock(static_cast<const BlockStmt&>(s), std::forward<Args>(args)...);
+            case NodeKind::FnDecl:     return d.visitFnDecl(static_cast<const FnDeclStmt&>(s), std::forward<Args>(args)...);
+            case NodeKind::Program:    return d.visitProgram(static_cast<const Program&>(s), std::forward<Args>(args)...);
+            default:                   return d.visitUnknownStmt(s, std::forward<Args>(args)...);
+        }
+    }
+
+    template <typename... Args>
+    R visitUnknownStmt(const Stmt&, Args&&...) { return R(); }
+};
@@ -1,9 +1,48 @@
 #include "lexer.h"
+#include "SourceMap.h"
+#include <algorithm>
 #include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <exception>
 #include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
 #include <unordered_map>
 
-Lexer::Lexer(const std::string& input) : source(input), currentPos(0), currentChar(input[0]) {}
+Lexer::Lexer() : currentPos(0), currentChar('\0'), diagnostics(&std::cerr) {}
+
+Lexer::Lexer(const std::string& input) : ownedSource(input), diagnostics(&std::cerr) {
+    reset(ownedSource);
+}
+
+void Lexer::reportInvalid(size_t offset, char c) {
+    std::ostream& out = *diagnostics;
+    if (locations) {
+        SourcePosition p = locations->position((uint32_t)offset);
+        out << locations->name() << ':' << p.line << ':' << p.column << ": ";
+    }
+    out << "Invalid token: '" << c << "' (ASCII: " << (int)c << ")\n";
+}
+
+void Lexer::tokenTooLong(size_t offset) {
+    std::ostringstream message;
+    if (locations) {
+        SourcePosition p = locations->position((uint32_t)offset);
+        message << locations->name() << ':' << p.line << ':' << p.column << ": ";
+    }
+    message << "Token too long: limit is " << maxTokenLength << " bytes";
+    throw std::length_error(message.str());
+}
+
+void Lexer::reset(std::string_view input) {
+    source = input;
+    currentPos = 0;
+    currentChar = source.empty() ? '\0' : source[0];
+}
 
 void Lexer::advance() {
     if (currentPos < source.length()) {
@@ -17,7 +56,7 @@ void Lexer::advance() {
 }
 
 void Lexer::skipWhitespace() {
-    while (std::isspace(currentChar)) {
+    while (std::isspace((unsigned char)currentChar)) {
         advance();
     }
 }
@@ -122,15 +161,26 @@ Token Lexer::consumeSymbol() {
 
 std::vector<Token> Lexer::tokenize() {
     std::vector<Token> tokens;
+    tokenize(tokens);
+    return tokens;
+}
 
-    while (currentChar != '\0') {
+void Lexer::tokenize(std::vector<Token>& tokens) {
+    if (source.size() > UINT32_MAX) throw std::length_error("Input too large for 32-bit token offsets");
+    tokens.clear();
+    scan(source.size(), tokens);
+}
+
+void Lexer::scan(size_t last, std::vector<Token>& tokens) {
+    while (currentChar != '\0' && currentPos < last) {
         skipWhitespace();
         
-        // Check for end of input after skipping whitespace
-        if (currentChar == '\0') {
+        // Check for end of input (or of this chunk) after skipping whitespace
+        if (currentChar == '\0' || currentPos >= last) {
             break;
         }
 
+        uint32_t start = (uint32_t)currentPos;
         if (isAlpha(currentChar)) {
             tokens.push_back(consumeIdentifier());
         }
@@ -149,10 +199,405 @@ std::vector<Token> Lexer::tokenize() {
             tokens.push_back(consumeSymbol());
         }
         else {
-            std::cerr << "Invalid token: '" << currentChar << "' (ASCII: " << (int)currentChar << ")" << std::endl;
+            reportInvalid(currentPos, currentChar);
             advance();
+            continue;
         }
+        if (currentPos - start > maxTokenLength) tokenTooLong(start);
+        tokens.back().offset = start;
     }
+}
+
+void Lexer::tokenize(TokenBuffer& out) {
+    if (source.size() > UINT32_MAX) throw std::length_error("Input too large for 32-bit token offsets");
+    out.clear();
+    out.source = source;
+    scanPacked(source.size(), out);
+}
+
+// Same rules as tokenize()'s consumeX methods, but slices the source instead of
+// building a std::string per token.
+void Lexer::scanPacked(size_t last, TokenBuffer& out) {
+    const char* s = source.data();
+    const size_t n = source.size();
+    size_t i = currentPos;
 
+    while (i < last && s[i] != '\0') {
+        char c = s[i];
+        if (std::isspace((unsigned char)c)) {
+            ++i;
+            continue;
+        }
+
+        size_t start = i;
+        if (isAlpha(c)) {
+            while (i < n && (isAlpha(s[i]) || isDigit(s[i]))) ++i;
+            std::string_view word(s + start, i - start);
+            TokenType t = TokenType::IDENTIFIER;
+            if (word == "fn") t = TokenType::FUNCTION;
+            else if (word == "int") t = TokenType::INT;
+            else if (word == "float") t = TokenType::FLOAT;
+            else if (word == "string") t = TokenType::STRING;
+            else if (word == "return") t = TokenType::RETURN;
+            out.push(t, start, i - start);
+        }
+        else if (isDigit(c)) {
+            while (i < n && isDigit(s[i])) ++i;
+            if (i < n && s[i] == '.') {
+                ++i;
+                while (i < n && isDigit(s[i])) ++i;
+                out.pushFloat(start, i - start);
+            } else {
+                out.pushInt(start, i - start);
+            }
+        }
+        else if (c == '"') {
+            ++i;
+            while (i < n && s[i] != '"' && s[i] != '\0') ++i;
+            out.pushString(start, i - start - 1);
+            if (i < n) ++i;  // closing quote (or the NUL that cut the literal short)
+        }
+        else if (c == '=') {
+            bool eq = i + 1 < n && s[i + 1] == '=';
+            out.push(eq ? TokenType::EQUALSOP : TokenType::ASSIGNOP, start, eq ? 2 : 1);
+            i += eq ? 2 : 1;
+        }
+        else {
+            TokenType t;
+            switch (c) {
+                case '+': t = TokenType::ADDOP; break;
+                case '-': t = TokenType::SUBOP; break;
+                case '*': t = TokenType::MULOP; break;
+                case '/': t = TokenType::DIVOP; break;
+                case '(': t = TokenType::PARENL; break;
+                case ')': t = TokenType::PARENR; break;
+                case '{': t = TokenType::BRACEL; break;
+                case '}': t = TokenType::BRACER; break;
+                case ',': t = TokenType::COMMA; break;
+                case ';': t = TokenType::SEMICOLON; break;
+                default:  t = TokenType::ERROR; break;
+            }
+            if (t != TokenType::ERROR) {
+                out.push(t, start, 1);
+            } else {
+                reportInvalid(i, c);
+            }
+            ++i;
+        }
+        if (i - start > maxTokenLength) tokenTooLong(start);
+    }
+
+    currentPos = i;
+    currentChar = i < n ? s[i] : '\0';
+}
+
+// ---------- TokenBuffer ----------
+namespace {
+bool isWordChar(char c) { return std::isalnum((unsigned char)c) || c == '_'; }
+}
+
+void TokenBuffer::clear() {
+    source = std::string_view();
+    tokens.clear();
+    ints.clear();
+    floats.clear();
+    strings.clear();
+    locations.clear();
+    storage.clear();
+    for (auto& marks : wraps) marks.clear();
+}
+
+void TokenBuffer::push(TokenType type, size_t offset, size_t payload) {
+    PackedToken t;
+    t.offset = (uint32_t)offset;
+    t.kind = (uint32_t)type;
+    t.payload = (uint32_t)std::min<size_t>(payload, PackedToken::kLongLexeme);
+    tokens.push_back(t);
+}
+
+// Payload for the next entry of `table`. The index whose low bits equal
+// kBadLiteral is skipped with a filler entry so the two never collide.
+template <typename T>
+uint32_t TokenBuffer::nextSlot(std::vector<T>& table, std::vector<uint32_t>& marks) {
+    if ((table.size() & PackedToken::kMaxPayload) == PackedToken::kBadLiteral) table.emplace_back();
+    size_t index = table.size();
+    if (index != 0 && (index & PackedToken::kMaxPayload) == 0) marks.push_back((uint32_t)tokens.size());
+    return (uint32_t)(index & PackedToken::kMaxPayload);
+}
+
+void TokenBuffer::pushInt(size_t offset, size_t length) {
+    long long v = 0;
+    auto r = std::from_chars(source.data() + offset, source.data() + offset + length, v);
+    if (r.ec != std::errc() || r.ptr != source.data() + offset + length) {
+        push(TokenType::INTLIT, offset, 0);
+        tokens.back().payload = PackedToken::kBadLiteral;
+        return;
+    }
+    push(TokenType::INTLIT, offset, nextSlot(ints, wraps[0]));
+    ints.push_back(v);
+}
+
+void TokenBuffer::pushFloat(size_t offset, size_t length) {
+    double v = 0;
+    auto r = std::from_chars(source.data() + offset, source.data() + offset + length, v);
+    if (r.ec != std::errc() || r.ptr != source.data() + offset + length) {
+        push(TokenType::FLOATLIT, offset, 0);
+        tokens.back().payload = PackedToken::kBadLiteral;
+        return;
+    }
+    push(TokenType::FLOATLIT, offset, nextSlot(floats, wraps[1]));
+    floats.push_back(v);
+}
+
+void TokenBuffer::pushString(size_t offset, size_t length) {
+    push(TokenType::STRINGLIT, offset, nextSlot(strings, wraps[2]));
+    strings.push_back(Span{(uint32_t)offset + 1, (uint32_t)length});
+}
+
+void TokenBuffer::append(const TokenBuffer& part) {
+    // Literal payloads index `part`'s tables. While every index still fits the
+    // payload, rebasing is an add; otherwise each literal is re-slotted below.
+    auto fits = [](size_t a, size_t b) { return a + b < PackedToken::kBadLiteral; };
+    if (fits(ints.size(), part.ints.size()) && fits(floats.size(), part.floats.size()) &&
+        fits(strings.size(), part.strings.size())) {
+        const uint32_t intBase = (uint32_t)ints.size(), floatBase = (uint32_t)floats.size();
+        const uint32_t stringBase = (uint32_t)strings.size();
+        ints.insert(ints.end(), part.ints.begin(), part.ints.end());
+        floats.insert(floats.end(), part.floats.begin(), part.floats.end());
+        strings.insert(strings.end(), part.strings.begin(), part.strings.end());
+        size_t first = tokens.size();
+        tokens.insert(tokens.end(), part.tokens.begin(), part.tokens.end());
+        for (size_t i = first; i < tokens.size(); ++i) {
+            PackedToken& t = tokens[i];
+            if (t.payload == PackedToken::kBadLiteral) continue;
+            switch (t.type()) {
+                case TokenType::INTLIT:    t.payload += intBase; break;
+                case TokenType::FLOATLIT:  t.payload += floatBase; break;
+                case TokenType::STRINGLIT: t.payload += stringBase; break;
+                default: break;
+            }
+        }
+        return;
+    }
+    auto relocate = [&](const PackedToken& t, auto& table, const auto& from, std::vector<uint32_t>& marks) {
+        uint32_t slot = nextSlot(table, marks);
+        table.push_back(from[part.literal(t)]);
+        push(t.type(), t.offset, slot);
+    };
+    for (const PackedToken& t : part.tokens) {
+        if (t.payload == PackedToken::kBadLiteral) { tokens.push_back(t); continue; }
+        switch (t.type()) {
+            case TokenType::INTLIT:    relocate(t, ints, part.ints, wraps[0]); break;
+            case TokenType::FLOATLIT:  relocate(t, floats, part.floats, wraps[1]); break;
+            case TokenType::STRINGLIT: relocate(t, strings, part.strings, wraps[2]); break;
+            default:                   tokens.push_back(t); break;
+        }
+    }
+}
+
+std::string_view TokenBuffer::text(const PackedToken& t) const {
+    switch (t.type()) {
+        case TokenType::STRINGLIT: {
+            const Span& sp = strings[literal(t)];
+            return source.substr(sp.offset, sp.length);
+        }
+        case TokenType::INTLIT:
+        case TokenType::FLOATLIT: {
+            // literal payloads index the value tables, so re-measure the digits
+            size_t end = t.offset;
+            while (end < source.size() && std::isdigit((unsigned char)source[end])) ++end;
+            if (t.type() == TokenType::FLOATLIT && end < source.size() && source[end] == '.') {
+                ++end;
+                while (end < source.size() && std::isdigit((unsigned char)source[end])) ++end;
+            }
+            return source.substr(t.offset, end - t.offset);
+        }
+        default: {
+            if (t.payload != PackedToken::kLongLexeme) return source.substr(t.offset, t.payload);
+            // only identifiers get this long, and they end at the first non-word byte
+            size_t end = t.offset;
+            while (end < source.size() && isWordChar(source[end])) ++end;
+            return source.substr(t.offset, end - t.offset);
+        }
+    }
+}
+
+void TokenBuffer::assign(const std::vector<Token>& toks) {
+    clear();
+    for (const auto& t : toks) {
+        storage += t.type == TokenType::STRINGLIT ? "\"" + t.value + "\"" : t.value;
+        storage += ' ';
+    }
+    if (storage.size() > UINT32_MAX) throw std::length_error("Input too large for 32-bit token offsets");
+    source = storage;
+
+    locations.reserve(toks.size());
+    size_t offset = 0;
+    for (const auto& t : toks) {
+        locations.push_back(t.offset);
+        switch (t.type) {
+            case TokenType::INTLIT:    pushInt(offset, t.value.size()); break;
+            case TokenType::FLOATLIT:  pushFloat(offset, t.value.size()); break;
+            case TokenType::STRINGLIT: pushString(offset, t.value.size()); offset += 2; break;
+            default:
+                // text() could not re-measure a long lexeme that is not a plain word
+                if (t.value.size() >= PackedToken::kLongLexeme &&
+                    !std::all_of(t.value.begin(), t.value.end(), isWordChar))
+                    throw std::length_error("Token too long for packed encoding");
+                push(t.type, offset, t.value.size());
+                break;
+        }
+        offset += t.value.size() + 1;
+    }
+}
+
+namespace {
+// Runs body(0) .. body(chunks - 1), chunk 0 on the calling thread, and joins
+// every thread before returning. Returns the first chunk, in chunk order, whose
+// body threw (or `chunks`), leaving its exception in `error`. Chunks whose
+// thread could not be started run on the calling thread.
+template <typename Body>
+size_t runChunks(size_t chunks, Body body, std::exception_ptr& error) {
+    std::vector<std::exception_ptr> errors(chunks);
+    auto guarded = [&](size_t c) {
+        try {
+            body(c);
+        } catch (...) {
+            errors[c] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> pool;
+    size_t started = 1;
+    try {
+        pool.reserve(chunks - 1);
+        for (; started < chunks; ++started) pool.emplace_back(guarded, started);
+    } catch (...) {
+    }
+    guarded(0);
+    for (size_t c = started; c < chunks; ++c) guarded(c);
+    for (auto& th : pool) th.join();
+    for (size_t c = 0; c < chunks; ++c) {
+        if (errors[c]) {
+            error = errors[c];
+            return c;
+        }
+    }
+    return chunks;
+}
+}
+
+std::vector<size_t> Lexer::parallelCuts(unsigned threads, size_t minBytesPerThread, std::vector<char>& inString) const {
+    if (source.size() > UINT32_MAX) throw std::length_error("Input too large for 32-bit token offsets");
+    size_t first = currentPos;
+    size_t size = source.size() - first;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = (unsigned)std::min<size_t>(threads, size / std::max<size_t>(minBytesPerThread, 1));
+    // A NUL byte ends tokenize() early (or closes a string); leave that to the scalar path.
+    if (threads <= 1 || std::memchr(source.data() + first, '\0', size) != nullptr) return {};
+
+    // Chunk boundaries sit right after a whitespace byte, where no token but a
+    // string literal can be in progress.
+    std::vector<size_t> cuts{first};
+    for (unsigned t = 1; t < threads; ++t) {
+        size_t p = std::max(cuts.back() + 1, first + size / threads * t);
+        while (p < source.size() && !std::isspace((unsigned char)source[p - 1])) ++p;
+        if (p >= source.size()) break;
+        cuts.push_back(p);
+    }
+    cuts.push_back(source.size());
+    size_t chunks = cuts.size() - 1;
+
+    // '"' count per chunk; a chunk starts inside a literal iff the quotes
+    // before it are odd.
+    std::vector<size_t> quotes(chunks);
+    std::exception_ptr error;
+    runChunks(chunks, [&](size_t c) {
+        quotes[c] = (size_t)std::count(source.begin() + cuts[c], source.begin() + cuts[c + 1], '"');
+    }, error);
+    inString.assign(chunks, 0);
+    for (size_t c = 1, seen = 0; c < chunks; ++c) {
+        seen += quotes[c - 1];
+        inString[c] = seen % 2;
+    }
+    return cuts;
+}
+
+void Lexer::resume(size_t pos, bool inString) {
+    currentPos = pos;
+    currentChar = source[pos];
+    if (inString) {
+        while (currentChar != '"' && currentChar != '\0') advance();
+        advance();  // the closing quote
+    }
+}
+
+// Writes the chunks' diagnostics in source order, up to and including the chunk
+// that failed, which is what tokenize() prints before the same error.
+void Lexer::flushChunkDiagnostics(const std::vector<std::ostringstream>& diags, size_t failed) {
+    for (size_t c = 0; c < diags.size() && c <= failed; ++c) *diagnostics << diags[c].str();
+}
+
+std::vector<Token> Lexer::tokenizeParallel(unsigned threads, size_t minBytesPerThread) {
+    std::vector<char> inString;
+    std::vector<size_t> cuts = parallelCuts(threads, minBytesPerThread, inString);
+    if (cuts.empty()) return tokenize();
+    size_t chunks = cuts.size() - 1;
+
+    std::vector<std::vector<Token>> parts(chunks);
+    std::vector<std::ostringstream> diags(chunks);
+    std::exception_ptr error;
+    size_t failed = runChunks(chunks, [&](size_t c) {
+        Lexer chunk;
+        chunk.reset(source);
+        chunk.setDiagnostics(diags[c]);
+        chunk.setSourceMap(locations);
+        chunk.setMaxTokenLength(maxTokenLength);
+        chunk.resume(cuts[c], inString[c]);
+        parts[c].reserve((cuts[c + 1] - cuts[c]) / 4);
+        chunk.scan(cuts[c + 1], parts[c]);
+    }, error);
+    flushChunkDiagnostics(diags, failed);
+    if (error) std::rethrow_exception(error);
+
+    size_t total = 0;
+    for (auto& p : parts) total += p.size();
+    std::vector<Token> tokens;
+    tokens.reserve(total);
+    for (auto& p : parts) std::move(p.begin(), p.end(), std::back_inserter(tokens));
+    currentPos = source.size();
+    currentChar = '\0';
     return tokens;
+}
+
+void Lexer::tokenizeParallel(TokenBuffer& out, unsigned threads, size_t minBytesPerThread) {
+    std::vector<char> inString;
+    std::vector<size_t> cuts = parallelCuts(threads, minBytesPerThread, inString);
+    if (cuts.empty()) return tokenize(out);
+    size_t chunks = cuts.size() - 1;
+
+    std::vector<TokenBuffer> parts(chunks);
+    std::vector<std::ostringstream> diags(chunks);
+    std::exception_ptr error;
+    size_t failed = runChunks(chunks, [&](size_t c) {
+        Lexer chunk;
+        chunk.reset(source);
+        chunk.setDiagnostics(diags[c]);
+        chunk.setSourceMap(locations);
+        chunk.setMaxTokenLength(maxTokenLength);
+        chunk.resume(cuts[c], inString[c]);
+        parts[c].source = source;
+        parts[c].tokens.reserve((cuts[c + 1] - cuts[c]) / 4);
+        chunk.scanPacked(cuts[c + 1], parts[c]);
+    }, error);
+    flushChunkDiagnostics(diags, failed);
+    if (error) std::rethrow_exception(error);
+
+    out.clear();
+    out.source = source;
+    size_t total = 0;
+    for (auto& p : parts) total += p.size();
+    out.tokens.reserve(total);
+    for (auto& p : parts) out.append(p);
+    currentPos = source.size();
+    currentChar = '\0';
 }
\ No newline at end of file
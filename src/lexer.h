@@ -1,9 +1,16 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <iosfwd>
 #include <string>
+#include <string_view>
 #include <vector>
 
+class SourceMap;
+
 // Define token types
 enum class TokenType {
     FUNCTION,
@@ -34,19 +41,155 @@ enum class TokenType {
 struct Token {
     TokenType type;
     std::string value;
+    uint32_t offset;    // byte offset of the lexeme in the source (see SourceMap.h)
+
+    Token(TokenType t, const std::string& v, uint32_t off = 0) : type(t), value(v), offset(off) {}
+};
+
+// Packed 8-byte token: kind, byte offset of the lexeme in the source, and a
+// 24-bit payload. The payload is the lexeme length, except for literals where
+// it holds the low 24 bits of an index into TokenBuffer's side tables (or is
+// kBadLiteral if the value did not fit its type); use TokenBuffer::literal().
+// Identifiers of kLongLexeme bytes or more store kLongLexeme, and
+// TokenBuffer::text() re-measures them.
+struct PackedToken {
+    static constexpr uint32_t kMaxPayload = 0xFFFFFF;
+    static constexpr uint32_t kBadLiteral = kMaxPayload;
+    static constexpr uint32_t kLongLexeme = kMaxPayload;
+
+    uint32_t offset;
+    uint32_t kind : 8;
+    uint32_t payload : 24;
+
+    TokenType type() const { return static_cast<TokenType>(kind); }
+};
+static_assert(sizeof(PackedToken) == 8, "PackedToken must stay 8 bytes");
+
+// A token stream in packed form. Literal values are converted once, while
+// lexing, and stored in typed side tables; `source` must outlive the buffer.
+struct TokenBuffer {
+    struct Span { uint32_t offset, length; };
+
+    std::string_view source;
+    std::vector<PackedToken> tokens;
+    std::vector<long long> ints;       // INTLIT values
+    std::vector<double> floats;        // FLOATLIT values
+    std::vector<Span> strings;         // STRINGLIT contents, quotes excluded
+    std::vector<uint32_t> locations;   // assign() only: Token::offset of each token
+
+    TokenBuffer() = default;
+    TokenBuffer(const TokenBuffer&) = delete;   // `source` may point into `storage`
+    TokenBuffer& operator=(const TokenBuffer&) = delete;
+
+    // Packs an already lexed token vector (the buffer owns a copy of the text).
+    void assign(const std::vector<Token>& toks);
+    // Empties the buffer but keeps every table's capacity.
+    void clear();
 
-    Token(TokenType t, const std::string& v) : type(t), value(v) {}
+    size_t size() const { return tokens.size(); }
+    TokenType type(size_t i) const { return tokens[i].type(); }
+
+    // What Token::value would hold for this token.
+    std::string_view text(const PackedToken& t) const;
+    // Index of a literal token's entry in ints, floats or strings (by its kind).
+    // `t` must be an element of `tokens`.
+    size_t literal(const PackedToken& t) const {
+        const std::vector<uint32_t>& marks = wraps[wrapTable(t.type())];
+        if (marks.empty()) return t.payload;
+        size_t i = &t - tokens.data();
+        size_t high = std::upper_bound(marks.begin(), marks.end(), i) - marks.begin();
+        return high << 24 | t.payload;
+    }
+    // Where the token sits in the original source. Same as `t.offset` unless the
+    // buffer was filled by assign(), whose offsets point into its private copy.
+    uint32_t location(const PackedToken& t) const {
+        return locations.empty() ? t.offset : locations[&t - tokens.data()];
+    }
+    Token token(const PackedToken& t) const { return Token(t.type(), std::string(text(t)), location(t)); }
+
+    void push(TokenType type, size_t offset, size_t payload);
+    void pushInt(size_t offset, size_t length);
+    void pushFloat(size_t offset, size_t length);
+    void pushString(size_t offset, size_t length);   // offset of the opening quote
+    // Appends another buffer's tokens (both must view the same source).
+    void append(const TokenBuffer& part);
+
+private:
+    // Payloads only hold 24 bits of a side-table index. Each table records the
+    // token positions at which its index reached the next multiple of 2^24, so
+    // literal() recovers the high bits with a search that is skipped entirely
+    // below 16M literals of a kind.
+    static size_t wrapTable(TokenType type) {
+        return type == TokenType::INTLIT ? 0 : type == TokenType::FLOATLIT ? 1 : 2;
+    }
+    template <typename T> uint32_t nextSlot(std::vector<T>& table, std::vector<uint32_t>& marks);
+
+    std::string storage;
+    std::vector<uint32_t> wraps[3];    // ints, floats, strings
 };
 
 class Lexer {
 public:
+    Lexer();
     Lexer(const std::string& input);
+    Lexer(const Lexer&) = delete;             // `source` may point into `ownedSource`
+    Lexer& operator=(const Lexer&) = delete;
+
+    // Points the lexer at a new buffer without copying it; the caller keeps
+    // `input` alive until tokenizing is done. Lets one Lexer serve many inputs.
+    void reset(std::string_view input);
+
     std::vector<Token> tokenize();
+    // Same as tokenize(), but refills `out` so its capacity is reused across calls.
+    void tokenize(std::vector<Token>& out);
+
+    // Same tokens as tokenize(), in packed form. Refills `out`, which views this
+    // lexer's source (keep the input alive while `out` is used).
+    void tokenize(TokenBuffer& out);
+
+    // Same tokens as tokenize(), lexed on `threads` workers (0 = hardware concurrency),
+    // each getting at least `minBytesPerThread` bytes.
+    // The input is cut after whitespace; a chunk that starts inside a string literal
+    // (odd number of '"' before it) resumes after the closing quote, because the chunk
+    // before it reads that literal to its end. Diagnostics keep source order.
+    // If chunks throw, all workers are joined and the first error in source order
+    // is rethrown, so failures match tokenize()'s.
+    static constexpr size_t kMinBytesPerThread = 1 << 20;
+    std::vector<Token> tokenizeParallel(unsigned threads = 0, size_t minBytesPerThread = kMinBytesPerThread);
+    // Packed form: each chunk fills its own TokenBuffer, and the parts are
+    // spliced into `out` with their literal indices rebased.
+    void tokenizeParallel(TokenBuffer& out, unsigned threads = 0, size_t minBytesPerThread = kMinBytesPerThread);
+
+    // Where "Invalid token" messages go (std::cerr by default).
+    void setDiagnostics(std::ostream& out) { diagnostics = &out; }
+    // Prefixes those messages with "file:line:col: ". `map` must describe the
+    // text being lexed and outlive its use here; nullptr turns positions off.
+    void setSourceMap(const SourceMap* map) { locations = map; }
+    // Tokens longer than `bytes` (string literals with their quotes) make every
+    // tokenize form throw std::length_error at the first one, after the
+    // diagnostics for the text before it. Unlimited by default.
+    void setMaxTokenLength(size_t bytes) { maxTokenLength = bytes; }
 
 private:
-    std::string source;
+    std::string ownedSource;
+    std::string_view source;
     size_t currentPos;
     char currentChar;
+    std::ostream* diagnostics;
+    const SourceMap* locations = nullptr;
+    size_t maxTokenLength = SIZE_MAX;
+
+    // Lexes tokens that start before `last` (a token may run past it).
+    void scan(size_t last, std::vector<Token>& tokens);
+    void scanPacked(size_t last, TokenBuffer& out);
+    // Chunk boundaries for tokenizeParallel() (empty: use the scalar path), and
+    // whether each chunk starts inside a string literal.
+    std::vector<size_t> parallelCuts(unsigned threads, size_t minBytesPerThread, std::vector<char>& inString) const;
+    // Moves to `pos`, skipping the rest of a string literal if `inString`.
+    void resume(size_t pos, bool inString);
+    void reportInvalid(size_t offset, char c);
+    [[noreturn]] void tokenTooLong(size_t offset);
+    void flushChunkDiagnostics(const std::vector<std::ostringstream>& diags, size_t failed);
 
     // Methods to recognize and create tokens
     void advance();
@@ -57,8 +200,8 @@ private:
     Token consumeOperator();
     Token consumeSymbol();
 
-    bool isAlpha(char c) { return std::isalpha(c) || c == '_'; }
-    bool isDigit(char c) { return std::isdigit(c); }
+    bool isAlpha(char c) { return std::isalpha((unsigned char)c) || c == '_'; }
+    bool isDigit(char c) { return std::isdigit((unsigned char)c); }
 };
 
 #endif // LEXER_H
\ No newline at end of file
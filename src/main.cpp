@@ -1,3 +1,4 @@
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -7,6 +8,8 @@
 #include "lexer.h"
 #include "Parser.h"
 #include "AST.h"
+#include "Interpreter.h"
+#include "SourceMap.h"
 
 // Pretty name for TokenType (for readable token dumps)
 const char* tokenTypeName(TokenType t) {
@@ -49,11 +52,34 @@ std::string readFile(const std::string& path) {
 }
 
 int main(int argc, char** argv) {
+    std::string path, sourceCode;
     try {
         // 1) Load source (file path arg optional)
-        std::string sourceCode;
-        if (argc > 1) {
-            sourceCode = readFile(argv[1]);
+        //    --jobs N            lex, and parse top-level functions, on N threads (0 = all cores)
+        //    --run               execute main() after parsing
+        //    --hot-threshold N   calls before a function moves to the optimized tier
+        //    --profile-in FILE   reuse a profile from an earlier run (implies --run)
+        //    --profile-out FILE  write this run's per-function profile (implies --run)
+        //    --locations         print file:line:col after every AST node
+        //    --hash-cons         share identical subexpressions and report how many
+        std::string profileIn, profileOut;
+        int jobs = 1;
+        bool run = false, showLocations = false, hashCons = false;
+        EngineOptions engineOptions;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--jobs" && i + 1 < argc) jobs = std::atoi(argv[++i]);
+            else if (arg == "--run") run = true;
+            else if (arg == "--hot-threshold" && i + 1 < argc) engineOptions.hotCallThreshold = std::strtoull(argv[++i], nullptr, 10);
+            else if (arg == "--profile-in" && i + 1 < argc) { profileIn = argv[++i]; run = true; }
+            else if (arg == "--profile-out" && i + 1 < argc) { profileOut = argv[++i]; run = true; }
+            else if (arg == "--locations") showLocations = true;
+            else if (arg == "--hash-cons") hashCons = true;
+            else path = arg;
+        }
+
+        if (!path.empty()) {
+            sourceCode = readFile(path);
         } else {
             // Sample program
             sourceCode = R"(
@@ -68,36 +94,72 @@ int main(int argc, char** argv) {
         std::cout << "=== SOURCE CODE ===\n";
         std::cout << sourceCode << "\n";
 
-        // 2) Lex
-        Lexer lexer(sourceCode);
-        std::vector<Token> tokens = lexer.tokenize();
+        // 2) Lex (packed tokens; literal values are converted here)
+        SourceMap sourceMap(path.empty() ? "<input>" : path, sourceCode);
+        Lexer lexer;
+        lexer.reset(sourceCode);
+        lexer.setSourceMap(&sourceMap);
+        TokenBuffer tokens;
+        if (jobs == 1) lexer.tokenize(tokens);
+        else lexer.tokenizeParallel(tokens, (unsigned)jobs);
 
         // 3) Print tokens (optional but handy)
         std::cout << "=== TOKENS ===\n";
-        for (const auto& t : tokens) {
-            std::cout << tokenTypeName(t.type) << " \"" << t.value << "\"\n";
+        for (const auto& t : tokens.tokens) {
+            std::cout << tokenTypeName(t.type()) << " \"" << tokens.text(t) << "\"\n";
         }
 
         // 4) Parse
         Parser parser(tokens);
-        auto program = parser.parseProgram();
+        parser.setHashConsing(hashCons);
+        auto program = jobs == 1 ? parser.parseProgram() : parser.parseProgramParallel((unsigned)jobs);
 
         // 5) Print AST
         std::cout << "\n=== AST ===\n";
-        printAST(program);
+        printAST(program, 0, showLocations ? &sourceMap : nullptr);
+
+        if (hashCons) {
+            InternStats st = parser.hashConsStats();
+            std::cout << "\n=== HASH-CONSING ===\n";
+            std::cout << "expressions: " << st.requested << " built, " << st.unique << " unique";
+            if (st.unique) std::cout << " (" << (double)st.requested / st.unique << "x)";
+            std::cout << "\nbytes saved: " << st.bytesSaved() << " net (" << st.duplicateBytes
+                      << " in dropped duplicates, " << st.tableBytes << " for the table)\n";
+            parser.setHashConsing(false);   // done parsing: free the table
+        }
 
         std::cout << "\n=== SUCCESS ===\n";
         std::cout << "Parsing completed successfully!\n";
 
+        // 6) Run (optional)
+        if (run) {
+            ExecutionEngine engine(program, engineOptions);
+            if (!profileIn.empty()) engine.loadProfile(profileIn);
+            Value result = engine.run();
+
+            std::cout << "\n=== RUN ===\n";
+            std::cout << "main returned: " << valueToString(result) << "\n";
+            std::cout << "Profile (calls, tier):\n";
+            for (const auto& p : engine.profile()) {
+                std::cout << "  " << p.name << " " << p.calls << " " << (p.optimized ? "optimized" : "tree") << "\n";
+            }
+            if (!profileOut.empty()) engine.dumpProfile(profileOut);
+        }
+
         return 0;
 
     } catch (const ParseException& ex) {
+        if (ex.offset) std::cerr << SourceMap(path.empty() ? "<input>" : path, sourceCode).format(*ex.offset) << ": ";
         std::cerr << "Parse error: " << ex.what() << "\n";
         if (ex.token) {
             std::cerr << "At token: (" << tokenTypeName(ex.token->type)
                       << ", \"" << ex.token->value << "\")\n";
         }
         return 1;
+    } catch (const RuntimeError& ex) {
+        if (ex.offset) std::cerr << SourceMap(path.empty() ? "<input>" : path, sourceCode).format(*ex.offset) << ": ";
+        std::cerr << "Runtime error: " << ex.what() << "\n";
+        return 1;
     } catch (const std::exception& ex) {
         std::cerr << "Error: " << ex.what() << "\n";
         return 1;
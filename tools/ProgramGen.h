@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+
+// Source shared by the tools under tools/: `fns` copies of a small function
+// mixing every operator, literal kind and a call, named f0, f1, ...
+inline std::string generateProgram(int fns) {
+    std::string s;
+    for (int i = 0; i < fns; ++i) {
+        s += "fn f" + std::to_string(i) + "(int a, float b) {\n"
+             "    int x = (a + b) * -a / g(a, 2, \"s\") == 3;\n"
+             "    return x - (1 + (2 * (3 - a)));\n"
+             "}\n";
+    }
+    return s;
+}
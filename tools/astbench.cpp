@@ -0,0 +1,258 @@
+// AST node sizes and expression traversal throughput.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -Isrc tools/astbench.cpp
+//             src/lexer.cpp src/Parser.cpp src/AST.cpp src/SourceMap.cpp src/ExprInterner.cpp -o build/astbench
+// Usage:  build/astbench [--fns N] [--iterations N]
+//
+// Prints sizeof every node type next to the layout nodes had before Visitor.h,
+// when Expr and Stmt had virtual destructors. The old expression nodes are
+// rebuilt below (legacy::) so both layouts can be measured in one binary.
+//
+// Throughput: a generated program of --fns functions (22 expression nodes
+// each) is parsed and copied into the old layout, then the nodes of every
+// expression tree are counted --iterations times three ways: old layout with a
+// hand-written switch, current layout with a hand-written switch, current
+// layout with ExprVisitor. Each line reports the best run.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Parser.h"
+#include "ProgramGen.h"
+#include "Visitor.h"
+
+namespace {
+
+// Expression nodes as they were laid out before Visitor.h.
+namespace legacy {
+struct Expr {
+    NodeKind kind;
+    explicit Expr(NodeKind k) : kind(k) {}
+    virtual ~Expr() = default;
+};
+using ExprPtr = std::shared_ptr<Expr>;
+
+struct BinaryExpr : Expr {
+    TokenType op;
+    ExprPtr left, right;
+    BinaryExpr(TokenType op, ExprPtr l, ExprPtr r)
+        : Expr(NodeKind::Binary), op(op), left(std::move(l)), right(std::move(r)) {}
+};
+struct UnaryExpr : Expr {
+    TokenType op;
+    ExprPtr expr;
+    UnaryExpr(TokenType op, ExprPtr e) : Expr(NodeKind::Unary), op(op), expr(std::move(e)) {}
+};
+struct IdentExpr : Expr {
+    std::string name;
+    explicit IdentExpr(std::string n) : Expr(NodeKind::Identifier), name(std::move(n)) {}
+};
+struct IntLitExpr : Expr {
+    long long value;
+    explicit IntLitExpr(long long v) : Expr(NodeKind::IntLit), value(v) {}
+};
+struct FloatLitExpr : Expr {
+    double value;
+    explicit FloatLitExpr(double v) : Expr(NodeKind::FloatLit), value(v) {}
+};
+struct StringLitExpr : Expr {
+    std::string value;
+    explicit StringLitExpr(std::string v) : Expr(NodeKind::StringLit), value(std::move(v)) {}
+};
+struct CallExpr : Expr {
+    std::string callee;
+    std::vector<ExprPtr> args;
+    CallExpr(std::string c, std::vector<ExprPtr> a)
+        : Expr(NodeKind::Call), callee(std::move(c)), args(std::move(a)) {}
+};
+struct Stmt {
+    NodeKind kind;
+    explicit Stmt(NodeKind k) : kind(k) {}
+    virtual ~Stmt() = default;
+};
+} // namespace legacy
+
+using Clock = std::chrono::steady_clock;
+
+double millis(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// Copies a parsed expression into the old layout. The generated program nests
+// only a few levels, so recursion is fine here.
+struct ToLegacy : ExprVisitor<ToLegacy, legacy::ExprPtr> {
+    legacy::ExprPtr visitBinary(const BinaryExpr& b) {
+        return std::make_shared<legacy::BinaryExpr>(b.op, visitExpr(*b.left), visitExpr(*b.right));
+    }
+    legacy::ExprPtr visitUnary(const UnaryExpr& u) {
+        return std::make_shared<legacy::UnaryExpr>(u.op, visitExpr(*u.expr));
+    }
+    legacy::ExprPtr visitIdentifier(const IdentExpr& i) { return std::make_shared<legacy::IdentExpr>(i.name); }
+    legacy::ExprPtr visitIntLit(const IntLitExpr& l) { return std::make_shared<legacy::IntLitExpr>(l.value); }
+    legacy::ExprPtr visitFloatLit(const FloatLitExpr& l) { return std::make_shared<legacy::FloatLitExpr>(l.value); }
+    legacy::ExprPtr visitStringLit(const StringLitExpr& l) { return std::make_shared<legacy::StringLitExpr>(l.value); }
+    legacy::ExprPtr visitCall(const CallExpr& c) {
+        std::vector<legacy::ExprPtr> args;
+        for (const auto& a : c.args) args.push_back(visitExpr(*a));
+        return std::make_shared<legacy::CallExpr>(c.callee, std::move(args));
+    }
+};
+
+// The three walkers compute the same thing: the number of nodes in the tree.
+long long countLegacy(const legacy::Expr& e) {
+    switch (e.kind) {
+        case NodeKind::Binary: {
+            const auto& b = static_cast<const legacy::BinaryExpr&>(e);
+            return 1 + countLegacy(*b.left) + countLegacy(*b.right);
+        }
+        case NodeKind::Unary: return 1 + countLegacy(*static_cast<const legacy::UnaryExpr&>(e).expr);
+        case NodeKind::Call: {
+            long long n = 1;
+            for (const auto& a : static_cast<const legacy::CallExpr&>(e).args) n += countLegacy(*a);
+            return n;
+        }
+        default: return 1;
+    }
+}
+
+long long countSwitch(const Expr& e) {
+    switch (e.kind) {
+        case NodeKind::Binary: {
+            const auto& b = static_cast<const BinaryExpr&>(e);
+            return 1 + countSwitch(*b.left) + countSwitch(*b.right);
+        }
+        case NodeKind::Unary: return 1 + countSwitch(*static_cast<const UnaryExpr&>(e).expr);
+        case NodeKind::Call: {
+            long long n = 1;
+            for (const auto& a : static_cast<const CallExpr&>(e).args) n += countSwitch(*a);
+            return n;
+        }
+        default: return 1;
+    }
+}
+
+struct Counter : ExprVisitor<Counter, long long> {
+    long long visitBinary(const BinaryExpr& b) { return 1 + visitExpr(*b.left) + visitExpr(*b.right); }
+    long long visitUnary(const UnaryExpr& u) { return 1 + visitExpr(*u.expr); }
+    long long visitIdentifier(const IdentExpr&) { return 1; }
+    long long visitIntLit(const IntLitExpr&) { return 1; }
+    long long visitFloatLit(const FloatLitExpr&) { return 1; }
+    long long visitStringLit(const StringLitExpr&) { return 1; }
+    long long visitCall(const CallExpr& c) {
+        long long n = 1;
+        for (const auto& a : c.args) n += visitExpr(*a);
+        return n;
+    }
+};
+
+// Every statement's expression in every function body, in source order.
+std::vector<const Expr*> collectRoots(const Program& program) {
+    std::vector<const Expr*> roots;
+    for (const auto& item : program.items) {
+        if (item->kind != NodeKind::FnDecl) continue;
+        for (const auto& s : static_cast<const FnDeclStmt&>(*item).body->statements) {
+            if (s->kind == NodeKind::VarDecl) roots.push_back(static_cast<const VarDeclStmt&>(*s).init.get());
+            else if (s->kind == NodeKind::ReturnStmt) roots.push_back(static_cast<const ReturnStmt&>(*s).expr.get());
+            else if (s->kind == NodeKind::ExprStmt) roots.push_back(static_cast<const ExprStmt&>(*s).expr.get());
+        }
+    }
+    return roots;
+}
+
+// Runs `walk` once over all roots; returns the time in ms.
+template <typename Roots, typename Walk>
+double timeWalk(const Roots& roots, long long& sum, Walk walk) {
+    auto t0 = Clock::now();
+    long long s = 0;
+    for (const auto& r : roots) if (r) s += walk(*r);
+    double ms = millis(t0, Clock::now());
+    sum = s;
+    return ms;
+}
+
+void printSize(const char* name, size_t now, size_t before) {
+    std::cout << "  " << name << " " << now;
+    if (before) std::cout << " (vtable layout " << before << ")";
+    std::cout << "\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int fns = 20000;
+    int iterations = 20;
+
+    for (int i = 1; i < argc; ++i) {
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) { std::cerr << "Missing value for " << argv[i] << "\n"; std::exit(2); }
+            return argv[++i];
+        };
+        if (!std::strcmp(argv[i], "--fns")) fns = std::atoi(next());
+        else if (!std::strcmp(argv[i], "--iterations")) iterations = std::atoi(next());
+        else { std::cerr << "Unknown argument: " << argv[i] << "\n"; return 2; }
+    }
+
+    try {
+        std::cout << "node sizes (bytes):\n";
+        printSize("Expr", sizeof(Expr), sizeof(legacy::Expr));
+        printSize("Stmt", sizeof(Stmt), sizeof(legacy::Stmt));
+        printSize("BinaryExpr", sizeof(BinaryExpr), sizeof(legacy::BinaryExpr));
+        printSize("UnaryExpr", sizeof(UnaryExpr), sizeof(legacy::UnaryExpr));
+        printSize("IdentExpr", sizeof(IdentExpr), sizeof(legacy::IdentExpr));
+        printSize("IntLitExpr", sizeof(IntLitExpr), sizeof(legacy::IntLitExpr));
+        printSize("FloatLitExpr", sizeof(FloatLitExpr), sizeof(legacy::FloatLitExpr));
+        printSize("StringLitExpr", sizeof(StringLitExpr), sizeof(legacy::StringLitExpr));
+        printSize("CallExpr", sizeof(CallExpr), sizeof(legacy::CallExpr));
+        printSize("VarDeclStmt", sizeof(VarDeclStmt), 0);
+        printSize("ReturnStmt", sizeof(ReturnStmt), 0);
+        printSize("FnDeclStmt", sizeof(FnDeclStmt), 0);
+
+        const std::string source = generateProgram(fns);
+        Lexer lexer;
+        lexer.reset(source);
+        TokenBuffer tokens;
+        lexer.tokenize(tokens);
+        std::shared_ptr<Program> program = Parser(tokens).parseProgram();
+
+        std::vector<const Expr*> roots = collectRoots(*program);
+        std::vector<legacy::ExprPtr> legacyRoots;
+        ToLegacy toLegacy;
+        for (const Expr* r : roots) legacyRoots.push_back(r ? toLegacy.visitExpr(*r) : nullptr);
+
+        Counter counter;
+        long long oldSum = 0, switchSum = 0, visitorSum = 0;
+        double oldMs = 0, switchMs = 0, visitorMs = 0;
+        // interleaved, so clock ramp-up and neighbours' load hit all three alike
+        for (int i = 0; i < iterations; ++i) {
+            double ms = timeWalk(legacyRoots, oldSum, [](const legacy::Expr& e) { return countLegacy(e); });
+            if (i == 0 || ms < oldMs) oldMs = ms;
+            ms = timeWalk(roots, switchSum, [](const Expr& e) { return countSwitch(e); });
+            if (i == 0 || ms < switchMs) switchMs = ms;
+            ms = timeWalk(roots, visitorSum, [&](const Expr& e) { return counter.visitExpr(e); });
+            if (i == 0 || ms < visitorMs) visitorMs = ms;
+        }
+        if (oldSum != switchSum || switchSum != visitorSum) {
+            std::cerr << "Walkers disagree: " << oldSum << " " << switchSum << " " << visitorSum << "\n";
+            return 1;
+        }
+
+        auto report = [&](const char* name, double ms) {
+            std::cout << name << " " << ms << "ms (best of " << iterations << ")";
+            if (ms > 0) std::cout << " " << visitorSum / ms / 1000 << " Mnodes/s";
+            std::cout << "\n";
+        };
+        std::cout << "traversal fns=" << fns << " expression nodes=" << visitorSum << "\n";
+        report("  vtable layout, switch:", oldMs);
+        report("  current layout, switch:", switchMs);
+        report("  current layout, ExprVisitor:", visitorMs);
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+}
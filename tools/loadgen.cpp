@@ -0,0 +1,91 @@
+// Load generator for CompileService.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -Isrc tools/loadgen.cpp src/CompileService.cpp
+//             src/lexer.cpp src/Parser.cpp src/AST.cpp src/SourceMap.cpp src/ExprInterner.cpp -o build/loadgen
+// Usage:  build/loadgen [--workers N] [--clients N] [--requests N] [--fns N] [--inflight N] [file]
+//
+// Each client thread keeps up to --inflight requests outstanding. The request body is
+// `file` when given, otherwise a generated program with --fns function declarations.
+
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CompileService.h"
+#include "ProgramGen.h"
+
+static std::string readFile(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) throw std::runtime_error("Could not open file: " + path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+int main(int argc, char** argv) {
+    unsigned workers = std::thread::hardware_concurrency();
+    unsigned clients = 4;
+    long requests = 100000;
+    int fns = 20;
+    size_t inflight = 8;
+    std::string file;
+
+    for (int i = 1; i < argc; ++i) {
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) { std::cerr << "Missing value for " << argv[i] << "\n"; std::exit(2); }
+            return argv[++i];
+        };
+        if (!std::strcmp(argv[i], "--workers")) workers = (unsigned)std::atoi(next());
+        else if (!std::strcmp(argv[i], "--clients")) clients = (unsigned)std::atoi(next());
+        else if (!std::strcmp(argv[i], "--requests")) requests = std::atol(next());
+        else if (!std::strcmp(argv[i], "--fns")) fns = std::atoi(next());
+        else if (!std::strcmp(argv[i], "--inflight")) inflight = (size_t)std::atol(next());
+        else file = argv[i];
+    }
+    if (clients == 0) clients = 1;
+    if (inflight == 0) inflight = 1;
+
+    try {
+        const std::string source = file.empty() ? generateProgram(fns) : readFile(file);
+        std::atomic<long> failures{0};
+        CompileService service(workers);
+
+        std::vector<std::thread> clientThreads;
+        for (unsigned c = 0; c < clients; ++c) {
+            long quota = requests / clients + (c < requests % clients ? 1 : 0);
+            clientThreads.emplace_back([&, quota] {
+                std::deque<std::future<CompileResult>> pending;
+                for (long sent = 0; sent < quota || !pending.empty();) {
+                    if (sent < quota && pending.size() < inflight) {
+                        pending.push_back(service.submit(source));
+                        ++sent;
+                        continue;
+                    }
+                    if (!pending.front().get().ok) failures.fetch_add(1, std::memory_order_relaxed);
+                    pending.pop_front();
+                }
+            });
+        }
+        for (auto& t : clientThreads) t.join();
+
+        ServiceMetrics m = service.metrics();
+        service.shutdown();
+
+        std::cout << "workers=" << (workers ? workers : 1) << " clients=" << clients
+                  << " inflight=" << inflight << " bytes/request=" << source.size() << "\n";
+        std::cout << "completed=" << m.completed << " failed=" << failures.load()
+                  << " elapsed=" << m.elapsedSeconds << "s\n";
+        std::cout << "throughput=" << m.throughput << " req/s"
+                  << " p50=" << m.p50Micros << "us p99=" << m.p99Micros << "us\n";
+        return failures.load() == 0 ? 0 : 1;
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+}
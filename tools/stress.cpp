@@ -0,0 +1,165 @@
+// Stress driver for the parser's stack-free paths and its throughput.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -Isrc tools/stress.cpp
+//             src/lexer.cpp src/Parser.cpp src/AST.cpp src/SourceMap.cpp src/ExprInterner.cpp -o build/stress
+// Usage:  build/stress [--depth N] [--print] [--fns N] [--iterations N]
+//
+// Deep shapes: one function whose return expression is N nested parens, N unary
+// '-', N nested calls, or a left-deep chain of N binary operators. Each is parsed
+// with the nesting limit lifted (it must succeed) and with the default limit
+// (deeper than kDefaultMaxNestingDepth it must raise NestingTooDeep), then freed.
+// --print also walks every tree with printAST(), whose output is indented by
+// depth, so keep --depth modest with it. Run under `ulimit -s 1024` to check
+// that nothing recurses per level.
+//
+// Throughput: a generated program of --fns functions is parsed and freed
+// --iterations times.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "Parser.h"
+#include "ProgramGen.h"
+
+namespace {
+
+// Swallows printAST() output, keeping only its size.
+class CountingBuf : public std::streambuf {
+public:
+    size_t bytes = 0;
+protected:
+    int_type overflow(int_type c) override {
+        if (c != traits_type::eof()) ++bytes;
+        return traits_type::not_eof(c);
+    }
+    std::streamsize xsputn(const char*, std::streamsize n) override {
+        bytes += (size_t)n;
+        return n;
+    }
+};
+
+using Clock = std::chrono::steady_clock;
+
+double millis(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+std::string deepProgram(const std::string& shape, size_t n) {
+    std::string s = "fn f(int x, int y) { return ";
+    if (shape == "paren") {
+        s += std::string(n, '(') + "x" + std::string(n, ')');
+    } else if (shape == "unary") {
+        for (size_t i = 0; i < n; ++i) s += "- ";
+        s += "x";
+    } else if (shape == "call") {
+        for (size_t i = 0; i < n; ++i) s += "f(";
+        s += "x" + std::string(n, ')');
+    } else {
+        s += "x";
+        for (size_t i = 0; i < n; ++i) s += " + y * 2";
+    }
+    return s + "; }\n";
+}
+
+// Parses one deep shape twice; returns false if either outcome is wrong.
+bool runShape(const std::string& shape, size_t depth, bool print) {
+    const std::string source = deepProgram(shape, depth);
+    Lexer lexer;
+    lexer.reset(source);
+    TokenBuffer tokens;
+    lexer.tokenize(tokens);
+
+    auto t0 = Clock::now();
+    Parser parser(tokens);
+    parser.setMaxNestingDepth(SIZE_MAX);
+    std::shared_ptr<Program> program;
+    try {
+        program = parser.parseProgram();
+    } catch (const ParseException& e) {
+        std::cout << shape << ": unexpected parse error: " << e.what() << "\n";
+        return false;
+    }
+    auto t1 = Clock::now();
+    CountingBuf sink;
+    if (print) {
+        std::streambuf* saved = std::cout.rdbuf(&sink);
+        printAST(program);
+        std::cout.rdbuf(saved);
+    }
+    auto t2 = Clock::now();
+    program.reset();
+    auto t3 = Clock::now();
+
+    bool limited = false;
+    try {
+        Parser(tokens).parseProgram();
+    } catch (const ParseException& e) {
+        limited = e.kind == ParseErrorKind::NestingTooDeep;
+    }
+    // a binary chain reduces as it goes, so it never nests
+    bool expectLimited = shape != "binary" && depth > Parser::kDefaultMaxNestingDepth;
+
+    std::cout << shape << " depth=" << depth << " parse=" << millis(t0, t1) << "ms";
+    if (print) std::cout << " print=" << millis(t1, t2) << "ms (" << sink.bytes << " bytes)";
+    std::cout << " free=" << millis(t2, t3) << "ms default-limit="
+              << (limited ? "NestingTooDeep" : "ok") << "\n";
+    if (limited != expectLimited) {
+        std::cout << shape << ": expected " << (expectLimited ? "NestingTooDeep" : "success")
+                  << " under the default nesting limit\n";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t depth = 1000000;
+    bool print = false;
+    int fns = 20000;
+    int iterations = 5;
+
+    for (int i = 1; i < argc; ++i) {
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) { std::cerr << "Missing value for " << argv[i] << "\n"; std::exit(2); }
+            return argv[++i];
+        };
+        if (!std::strcmp(argv[i], "--depth")) depth = (size_t)std::atol(next());
+        else if (!std::strcmp(argv[i], "--print")) print = true;
+        else if (!std::strcmp(argv[i], "--fns")) fns = std::atoi(next());
+        else if (!std::strcmp(argv[i], "--iterations")) iterations = std::atoi(next());
+        else { std::cerr << "Unknown argument: " << argv[i] << "\n"; return 2; }
+    }
+
+    try {
+        bool ok = true;
+        for (const char* shape : {"paren", "unary", "call", "binary"}) ok = runShape(shape, depth, print) && ok;
+
+        const std::string source = generateProgram(fns);
+        Lexer lexer;
+        lexer.reset(source);
+        TokenBuffer tokens;
+        lexer.tokenize(tokens);
+        double best = 0;
+        for (int i = 0; i < iterations; ++i) {
+            auto t0 = Clock::now();
+            Parser(tokens).parseProgram().reset();
+            double ms = millis(t0, Clock::now());
+            if (i == 0 || ms < best) best = ms;
+        }
+        if (iterations > 0) {
+            std::cout << "throughput fns=" << fns << " tokens=" << tokens.size() << " parse+free="
+                      << best << "ms (best of " << iterations << ") "
+                      << tokens.size() / best / 1000 << " Mtokens/s\n";
+        }
+        return ok ? 0 : 1;
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+}
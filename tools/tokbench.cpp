@@ -0,0 +1,118 @@
+// Token storage, lexing and parsing: std::vector<Token> against TokenBuffer.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -Isrc tools/tokbench.cpp
+//             src/lexer.cpp src/Parser.cpp src/AST.cpp src/SourceMap.cpp src/ExprInterner.cpp -o build/tokbench
+// Usage:  build/tokbench [--fns N] [--iterations N]
+//
+// A generated program of --fns functions (51 tokens each) is lexed into a
+// fresh std::vector<Token> and a fresh TokenBuffer, then parsed and freed from
+// each. Storage counts every table's capacity, spare capacity included (so
+// B/token is above sizeof), plus the heap blocks of lexemes too long for the
+// small-string buffer. Parser's std::vector<Token> constructor packs the
+// vector first, so its parse time includes that copy.
+// Times are the best of --iterations runs, the two forms interleaved.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Parser.h"
+#include "ProgramGen.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double millis(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+size_t storageBytes(const std::vector<Token>& tokens) {
+    size_t bytes = tokens.capacity() * sizeof(Token);
+    const size_t inline_ = std::string().capacity();
+    for (const Token& t : tokens) {
+        if (t.value.capacity() > inline_) bytes += t.value.capacity() + 1;
+    }
+    return bytes;
+}
+
+size_t storageBytes(const TokenBuffer& tokens) {
+    return tokens.tokens.capacity() * sizeof(PackedToken) + tokens.ints.capacity() * sizeof(long long)
+         + tokens.floats.capacity() * sizeof(double) + tokens.strings.capacity() * sizeof(TokenBuffer::Span)
+         + tokens.locations.capacity() * sizeof(uint32_t);
+}
+
+void keepBest(double& best, double ms, int i) {
+    if (i == 0 || ms < best) best = ms;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int fns = 50000;
+    int iterations = 5;
+
+    for (int i = 1; i < argc; ++i) {
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) { std::cerr << "Missing value for " << argv[i] << "\n"; std::exit(2); }
+            return argv[++i];
+        };
+        if (!std::strcmp(argv[i], "--fns")) fns = std::atoi(next());
+        else if (!std::strcmp(argv[i], "--iterations")) iterations = std::atoi(next());
+        else { std::cerr << "Unknown argument: " << argv[i] << "\n"; return 2; }
+    }
+
+    try {
+        const std::string source = generateProgram(fns);
+        Lexer lexer;
+        double lexVector = 0, lexPacked = 0, parseVector = 0, parsePacked = 0;
+        size_t count = 0, vectorBytes = 0, packedBytes = 0;
+
+        for (int i = 0; i < iterations; ++i) {
+            lexer.reset(source);
+            auto t0 = Clock::now();
+            std::vector<Token> vec = lexer.tokenize();
+            auto t1 = Clock::now();
+            Parser(vec).parseProgram().reset();
+            auto t2 = Clock::now();
+            keepBest(lexVector, millis(t0, t1), i);
+            keepBest(parseVector, millis(t1, t2), i);
+            vectorBytes = storageBytes(vec);
+            count = vec.size();
+            vec = std::vector<Token>();
+
+            lexer.reset(source);
+            TokenBuffer packed;
+            t0 = Clock::now();
+            lexer.tokenize(packed);
+            t1 = Clock::now();
+            Parser(packed).parseProgram().reset();
+            t2 = Clock::now();
+            keepBest(lexPacked, millis(t0, t1), i);
+            keepBest(parsePacked, millis(t1, t2), i);
+            packedBytes = storageBytes(packed);
+            if (packed.size() != count) {
+                std::cerr << "Token counts differ: " << count << " vs " << packed.size() << "\n";
+                return 1;
+            }
+        }
+        if (iterations <= 0) return 0;
+
+        const double mb = 1024.0 * 1024.0;
+        std::cout << "fns=" << fns << " tokens=" << count << " source=" << source.size() / mb << " MB\n";
+        std::cout << "storage: vector<Token> " << vectorBytes / mb << " MB (" << (double)vectorBytes / count
+                  << " B/token), TokenBuffer " << packedBytes / mb << " MB (" << (double)packedBytes / count
+                  << " B/token), " << (double)vectorBytes / packedBytes << "x\n";
+        std::cout << "lex: vector<Token> " << lexVector << "ms, TokenBuffer " << lexPacked
+                  << "ms (best of " << iterations << ")\n";
+        std::cout << "parse+free: vector<Token> " << parseVector << "ms, TokenBuffer " << parsePacked
+                  << "ms (best of " << iterations << ")\n";
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+}